@@ -0,0 +1,317 @@
+/** @file
+    @brief Thread which pumps the OSVR client context.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "ClientUpdateLoop.h"
+#include "Logging.h"
+
+// Library/third-party includes
+#include <osvr/ClientKit/Context.h>
+
+// Standard includes
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+const std::uint64_t ClientUpdateLoop::MinPeriodReports;
+
+ClientUpdateLoop::ClientUpdateLoop(osvr::clientkit::ClientContext& context) : context_(context)
+{
+    // do nothing
+}
+
+ClientUpdateLoop::~ClientUpdateLoop()
+{
+    stop();
+}
+
+void ClientUpdateLoop::setMode(Mode mode)
+{
+    mode_ = mode;
+}
+
+void ClientUpdateLoop::setReportCounter(ReportCounter counter)
+{
+    reportCounter_ = std::move(counter);
+}
+
+void ClientUpdateLoop::setAfterUpdate(UpdateHandler handler)
+{
+    afterUpdate_ = std::move(handler);
+}
+
+void ClientUpdateLoop::setActiveWaitPeriod(std::chrono::microseconds period)
+{
+    activeWaitPeriod_ = period;
+}
+
+void ClientUpdateLoop::setStandbyWaitPeriod(std::chrono::microseconds period)
+{
+    standbyWaitPeriod_ = period;
+}
+
+void ClientUpdateLoop::setEventSlack(std::chrono::microseconds slack)
+{
+    eventSlack_ = slack;
+}
+
+void ClientUpdateLoop::setEventMaxWaitPeriod(std::chrono::microseconds period)
+{
+    eventMaxWaitPeriod_ = period;
+}
+
+void ClientUpdateLoop::setVsyncClock(const VsyncClock* vsync_clock)
+{
+    vsyncClock_ = vsync_clock;
+}
+
+void ClientUpdateLoop::setVsyncUpdateOffset(std::chrono::microseconds offset)
+{
+    vsyncUpdateOffset_ = offset;
+}
+
+void ClientUpdateLoop::setVsyncLastUpdateOffset(std::chrono::microseconds offset)
+{
+    vsyncLastUpdateOffset_ = offset;
+}
+
+void ClientUpdateLoop::start()
+{
+    if (thread_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = false;
+    }
+
+    if (Mode::Event == mode_ && !reportCounter_) {
+        OSVR_LOG(warn) << "ClientUpdateLoop::start(): No report counter was provided. Falling back to " << Mode::Fixed << " mode.";
+        mode_ = Mode::Fixed;
+    }
+
+    if (Mode::Vsync == mode_ && !vsyncClock_) {
+        OSVR_LOG(warn) << "ClientUpdateLoop::start(): No vsync clock was provided. Falling back to " << Mode::Fixed << " mode.";
+        mode_ = Mode::Fixed;
+    }
+
+    if (Mode::Vsync == mode_) {
+        OSVR_LOG(info) << "ClientUpdateLoop::start(): The vsync clock is not phase-locked to the display, so updates will run twice per frame at an arbitrary phase.";
+    }
+
+    lastReportCount_ = 0;
+    reportPeriod_ = clock::duration::zero();
+    missedReport_ = false;
+    idleWaitPeriod_ = eventSlack_;
+    updateCount_.store(0);
+    startTime_ = clock::now();
+
+    OSVR_LOG(debug) << "ClientUpdateLoop::start(): Starting client update thread in " << mode_ << " mode.";
+    thread_ = std::thread(&ClientUpdateLoop::run, this);
+}
+
+void ClientUpdateLoop::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wakeup_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+
+        const auto updates = updateCount_.load();
+        const auto elapsed = std::chrono::duration<double>(clock::now() - startTime_).count();
+        OSVR_LOG(info) << "ClientUpdateLoop::stop(): Called update() " << updates << " times in " << elapsed << " seconds (" << updates / elapsed << " per second) in " << mode_ << " mode.";
+    }
+}
+
+void ClientUpdateLoop::setStandby(bool standby)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        standby_ = standby;
+    }
+    wakeup_.notify_all();
+}
+
+ClientUpdateLoop::Mode ClientUpdateLoop::getMode() const
+{
+    return mode_;
+}
+
+std::uint64_t ClientUpdateLoop::getUpdateCount() const
+{
+    return updateCount_.load(std::memory_order_relaxed);
+}
+
+void ClientUpdateLoop::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!quit_) {
+        const auto standby = standby_;
+        lock.unlock();
+
+        context_.update();
+        updateCount_.fetch_add(1, std::memory_order_relaxed);
+        if (afterUpdate_) {
+            afterUpdate_();
+        }
+
+        const auto now = clock::now();
+        auto wake_time = now;
+        if (standby || Mode::Fixed == mode_) {
+            wake_time = nextFixedWakeup(now, standby);
+        } else if (Mode::Event == mode_) {
+            wake_time = nextEventWakeup(now);
+        } else {
+            wake_time = nextVsyncWakeup(now);
+        }
+
+        lock.lock();
+        wakeup_.wait_until(lock, wake_time, [&] { return quit_ || standby != standby_; });
+    }
+}
+
+ClientUpdateLoop::clock::time_point ClientUpdateLoop::nextFixedWakeup(clock::time_point now, bool standby) const
+{
+    return now + (standby ? standbyWaitPeriod_ : activeWaitPeriod_);
+}
+
+ClientUpdateLoop::clock::time_point ClientUpdateLoop::nextEventWakeup(clock::time_point now)
+{
+    const auto report_count = reportCounter_();
+    if (report_count != lastReportCount_) {
+        const auto reports = report_count - lastReportCount_;
+        if (!missedReport_ && 1 == reports && clock::duration::zero() != reportPeriod_) {
+            // The report was there when we woke up for it, so all we know is
+            // that it wasn't late. Keep to the schedule rather than to our
+            // wakeup time, or the slack would pile up from one report to the
+            // next, and assume it came halfway through the slack. If that's
+            // too early, a later report will miss its wakeup and we'll
+            // measure where the reports really are.
+            lastReportTime_ += reportPeriod_ - eventSlack_ / 2;
+        } else {
+            // The reports arrived since the last update(), which was at most
+            // one wait period ago, so now is a fair estimate of when the last
+            // one came in. Measure the report period over as many reports as
+            // we've seen since the stream last (re)started, which makes that
+            // error small.
+            const auto interval = (now - lastReportTime_) / static_cast<clock::rep>(reports);
+            if (0 == lastReportCount_ || interval >= eventMaxWaitPeriod_) {
+                syncCount_ = report_count;
+                syncTime_ = now;
+            } else if (report_count - syncCount_ >= MinPeriodReports) {
+                reportPeriod_ = (now - syncTime_) / static_cast<clock::rep>(report_count - syncCount_);
+            }
+            lastReportTime_ = now;
+        }
+
+        lastReportCount_ = report_count;
+        missedReport_ = false;
+        idleWaitPeriod_ = eventSlack_;
+    }
+
+    if (clock::duration::zero() == reportPeriod_) {
+        // We don't know the report period yet.
+        return now + activeWaitPeriod_;
+    }
+
+    // Wake up once, just after the next report is due.
+    const auto expected = lastReportTime_ + reportPeriod_;
+    if (now < expected) {
+        return expected + eventSlack_;
+    }
+
+    // The report is late, or the tracker has stopped reporting. Back off
+    // until it shows up so we don't keep waking up for nothing.
+    missedReport_ = true;
+    const auto wait = idleWaitPeriod_;
+    idleWaitPeriod_ = std::min(idleWaitPeriod_ * 2, eventMaxWaitPeriod_);
+    return now + wait;
+}
+
+ClientUpdateLoop::clock::time_point ClientUpdateLoop::nextVsyncWakeup(clock::time_point now) const
+{
+    if (!vsyncClock_->valid()) {
+        // We don't know the refresh rate until the HMD has been activated.
+        return nextFixedWakeup(now, false);
+    }
+
+    // Pick the earliest planned update that is still in the future. Two
+    // frames are enough to always find one.
+    const auto vsync = vsyncClock_->nextVsync(now);
+    const auto period = vsyncClock_->getPeriod();
+    auto wake_time = vsync + period;
+    for (const auto frame_vsync : { vsync, vsync + period }) {
+        for (const auto offset : { vsyncUpdateOffset_, vsyncLastUpdateOffset_ }) {
+            const auto planned = frame_vsync - offset;
+            if (planned > now && planned < wake_time) {
+                wake_time = planned;
+            }
+        }
+    }
+
+    return wake_time;
+}
+
+ClientUpdateLoop::Mode parseClientUpdateMode(const std::string& str)
+{
+    auto mode = str;
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if ("event" == mode) {
+        return ClientUpdateLoop::Mode::Event;
+    } else if ("vsync" == mode) {
+        return ClientUpdateLoop::Mode::Vsync;
+    } else if ("fixed" == mode) {
+        return ClientUpdateLoop::Mode::Fixed;
+    } else {
+        OSVR_LOG(err) << "The string [" + str + "] could not be parsed as a client update mode. Use one of: fixed, event, vsync.";
+        return ClientUpdateLoop::Mode::Fixed;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, ClientUpdateLoop::Mode mode)
+{
+    switch (mode) {
+    case ClientUpdateLoop::Mode::Fixed:
+        os << "fixed";
+        break;
+    case ClientUpdateLoop::Mode::Event:
+        os << "event";
+        break;
+    case ClientUpdateLoop::Mode::Vsync:
+        os << "vsync";
+        break;
+    }
+    return os;
+}
@@ -0,0 +1,183 @@
+/** @file
+    @brief Thread which pumps the OSVR client context.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_ClientUpdateLoop_h_GUID_5E0B1F6A_8C2D_4B7E_9A41_3D6F2C8E7B10
+#define INCLUDED_ClientUpdateLoop_h_GUID_5E0B1F6A_8C2D_4B7E_9A41_3D6F2C8E7B10
+
+// Internal Includes
+#include "VsyncClock.h"
+
+// Library/third-party includes
+#include <osvr/ClientKit/Context.h>     // for osvr::clientkit::ClientContext
+
+// Standard includes
+#include <atomic>                       // for std::atomic
+#include <chrono>                       // for std::chrono
+#include <condition_variable>           // for std::condition_variable
+#include <cstdint>                      // for std::uint64_t
+#include <functional>                   // for std::function
+#include <mutex>                        // for std::mutex
+#include <ostream>                      // for std::ostream
+#include <string>                       // for std::string
+#include <thread>                       // for std::thread
+
+/**
+ * Runs @c ClientContext::update() on a dedicated thread.
+ *
+ * Three scheduling modes are available:
+ *
+ * - @c Fixed calls @c update() and then sleeps for the current wait period.
+ *   This is the original behavior and the default.
+ * - @c Event tracks when tracker reports arrive. Once the report period is
+ *   known, the thread wakes once per report, a small slack after it is due.
+ *   If the report hasn't arrived by then, the wait period backs off from the
+ *   slack up to a maximum until it does, so a late or idle tracker doesn't
+ *   keep the thread spinning. Only the HMD's reports are counted, so other
+ *   devices (such as the tracking camera) are only serviced as a side effect
+ *   of the HMD's schedule.
+ * - @c Vsync plans one update at a fixed offset before each predicted vsync
+ *   and a second, "last moment" update just before the compositor samples
+ *   poses. The thread then wakes twice per frame regardless of the tracker
+ *   report rate. Until the refresh rate is known it behaves like @c Fixed.
+ *   Note that the vsync clock is not phase-locked to the display (see
+ *   VsyncClock), so this is a twice-per-frame timer whose offsets are
+ *   relative to an arbitrary point in the frame, not to the real vsync.
+ *
+ * OSVR ClientKit doesn't expose its transport, so we can't block on the
+ * socket directly; predicting the arrival time is the closest we can get.
+ */
+class ClientUpdateLoop {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Mode {
+        Fixed,
+        Event,
+        Vsync
+    };
+
+    /**
+     * Returns the number of tracker reports received so far. Used by the
+     * event mode to learn when reports arrive.
+     */
+    using ReportCounter = std::function<std::uint64_t()>;
+
+    /**
+     * Called on the update thread each time update() returns.
+     */
+    using UpdateHandler = std::function<void()>;
+
+    explicit ClientUpdateLoop(osvr::clientkit::ClientContext& context);
+    ~ClientUpdateLoop();
+
+    ClientUpdateLoop(const ClientUpdateLoop&) = delete;
+    ClientUpdateLoop& operator=(const ClientUpdateLoop&) = delete;
+
+    /** \name Configuration (call before start()) */
+    //@{
+    void setMode(Mode mode);
+    void setReportCounter(ReportCounter counter);
+    void setAfterUpdate(UpdateHandler handler);
+    void setActiveWaitPeriod(std::chrono::microseconds period);
+    void setStandbyWaitPeriod(std::chrono::microseconds period);
+    void setEventSlack(std::chrono::microseconds slack);
+    void setEventMaxWaitPeriod(std::chrono::microseconds period);
+    void setVsyncClock(const VsyncClock* vsync_clock);
+    void setVsyncUpdateOffset(std::chrono::microseconds offset);
+    void setVsyncLastUpdateOffset(std::chrono::microseconds offset);
+    //@}
+
+    void start();
+    void stop();
+
+    /**
+     * Switches between the active and standby wait periods. Wakes the thread
+     * so the change takes effect immediately.
+     */
+    void setStandby(bool standby);
+
+    Mode getMode() const;
+
+    /**
+     * Returns the number of times update() has been called since start().
+     */
+    std::uint64_t getUpdateCount() const;
+
+private:
+    /// Number of reports to measure before trusting the report period
+    static const std::uint64_t MinPeriodReports = 8;
+
+    void run();
+
+    /**
+     * Returns the time the thread should next call update().
+     */
+    clock::time_point nextFixedWakeup(clock::time_point now, bool standby) const;
+    clock::time_point nextEventWakeup(clock::time_point now);
+    clock::time_point nextVsyncWakeup(clock::time_point now) const;
+
+    osvr::clientkit::ClientContext& context_;
+    Mode mode_ = Mode::Fixed;
+    ReportCounter reportCounter_;
+    UpdateHandler afterUpdate_;
+
+    std::chrono::microseconds activeWaitPeriod_ = std::chrono::milliseconds(1);
+    std::chrono::microseconds standbyWaitPeriod_ = std::chrono::milliseconds(100);
+    std::chrono::microseconds eventSlack_ = std::chrono::microseconds(250);
+    std::chrono::microseconds eventMaxWaitPeriod_ = std::chrono::milliseconds(10);
+    const VsyncClock* vsyncClock_ = nullptr;
+    std::chrono::microseconds vsyncUpdateOffset_ = std::chrono::milliseconds(6);
+    std::chrono::microseconds vsyncLastUpdateOffset_ = std::chrono::milliseconds(3);
+
+    // Guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool quit_ = false;
+    bool standby_ = false;
+
+    std::atomic<std::uint64_t> updateCount_ { 0 };
+    clock::time_point startTime_;
+
+    // Only touched by the update thread
+    std::uint64_t lastReportCount_ = 0;
+    clock::time_point lastReportTime_; ///< when the last report arrived, as best we know
+    std::uint64_t syncCount_ = 0; ///< report count when the report stream last (re)started
+    clock::time_point syncTime_;
+    clock::duration reportPeriod_ = clock::duration::zero();
+    bool missedReport_ = false; ///< the last report wasn't there when it was due
+    std::chrono::microseconds idleWaitPeriod_ = std::chrono::milliseconds(1);
+
+    std::thread thread_;
+};
+
+/**
+ * Parses a string into a client update mode. Returns @c Mode::Fixed for
+ * unrecognized values.
+ */
+ClientUpdateLoop::Mode parseClientUpdateMode(const std::string& str);
+
+std::ostream& operator<<(std::ostream& os, ClientUpdateLoop::Mode mode);
+
+#endif // INCLUDED_ClientUpdateLoop_h_GUID_5E0B1F6A_8C2D_4B7E_9A41_3D6F2C8E7B10
@@ -0,0 +1,476 @@
+/** @file
+    @brief Lens distortion helpers for ComputeDistortion().
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "Distortion.h"
+#include "Logging.h"
+
+// Library/third-party includes
+#include <osvr/RenderKit/DistortionCorrectTextureCoordinate.h>
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OSVR_DISTORTION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+double distance(const float a[2], const float b[2])
+{
+    const double du = a[0] - b[0];
+    const double dv = a[1] - b[1];
+    return std::sqrt(du * du + dv * dv);
+}
+
+} // anonymous namespace
+
+DistortionMode parseDistortionMode(const std::string& str)
+{
+    auto mode = str;
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if ("interpolator" == mode) {
+        return DistortionMode::Interpolator;
+    } else if ("table" == mode) {
+        return DistortionMode::Table;
+    } else if ("mesh" == mode) {
+        return DistortionMode::Mesh;
+    } else if ("quadtree" == mode) {
+        return DistortionMode::Quadtree;
+    } else if ("polynomial" == mode) {
+        return DistortionMode::Polynomial;
+    } else {
+        OSVR_LOG(err) << "The string [" + str + "] could not be parsed as a distortion mode. Use one of: interpolator, table, mesh, quadtree, polynomial.";
+        return DistortionMode::Interpolator;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, DistortionMode mode)
+{
+    switch (mode) {
+    case DistortionMode::Interpolator:
+        os << "interpolator";
+        break;
+    case DistortionMode::Table:
+        os << "table";
+        break;
+    case DistortionMode::Mesh:
+        os << "mesh";
+        break;
+    case DistortionMode::Quadtree:
+        os << "quadtree";
+        break;
+    case DistortionMode::Polynomial:
+        os << "polynomial";
+        break;
+    }
+    return os;
+}
+
+DistortionBatch makeDistortionBatch(vr::DistortionCoordinates_t& coords)
+{
+    return { { &coords.rfRed[0], &coords.rfRed[1] }, { &coords.rfGreen[0], &coords.rfGreen[1] }, { &coords.rfBlue[0], &coords.rfBlue[1] } };
+}
+
+DistortionBatchFunction makeBatchFunction(DistortionFunction distortion)
+{
+    return [distortion](const float* u, const float* v, std::size_t count, const DistortionBatch& out) {
+        for (std::size_t i = 0; i < count; ++i) {
+            storeDistortion(distortion(u[i], v[i]), out, i);
+        }
+    };
+}
+
+std::pair<float, float> rotate(float u, float v, osvr::display::Rotation rotation)
+{
+    // Rotates normalized coordinates counter-clockwise
+    using R = osvr::display::Rotation;
+    if (R::Zero == rotation) {
+        return { u, v };
+    } else if (R::Ninety == rotation) {
+        return { 1.0f - v, u };
+    } else if (R::OneEighty == rotation) {
+        return { 1.0f - u, 1.0f - v };
+    } else if (R::TwoSeventy == rotation) {
+        return { v, 1.0f - u };
+    } else {
+        OSVR_LOG(err) << "Unknown rotation [" << rotation << "] Assuming 0 degrees.";
+        return { u, v };
+    }
+}
+
+vr::DistortionCoordinates_t computeMeshDistortion(std::size_t eye, float u, float v, const osvr::renderkit::DistortionParameters& parameters, float overfill_factor, const MeshInterpolators& interpolators)
+{
+    // Note that RenderManager expects the (0, 0) to be the lower-left corner
+    // and (1, 1) to be the upper-right corner while SteamVR assumes (0, 0) is
+    // upper-left and (1, 1) is lower-right.  To accommodate this, we need to
+    // flip the y-coordinate before passing it to RenderManager and flip it
+    // again before returning the value to SteamVR.
+    using osvr::renderkit::DistortionCorrectTextureCoordinate;
+    static const size_t COLOR_RED = 0;
+    static const size_t COLOR_GREEN = 1;
+    static const size_t COLOR_BLUE = 2;
+
+    const auto in_coords = osvr::renderkit::Float2 {{u, 1.0f - v}}; // flip v-coordinate
+
+    auto coords_green = DistortionCorrectTextureCoordinate(
+        eye, in_coords, parameters,
+        COLOR_GREEN, overfill_factor, interpolators);
+
+    // Mono point samples have a single interpolator for every color, so
+    // there's no need to ask it three times.
+    const auto achromatic = (osvr::renderkit::DistortionParameters::mono_point_samples == parameters.m_type);
+
+    auto coords_red = achromatic ? coords_green : DistortionCorrectTextureCoordinate(
+        eye, in_coords, parameters,
+        COLOR_RED, overfill_factor, interpolators);
+
+    auto coords_blue = achromatic ? coords_green : DistortionCorrectTextureCoordinate(
+        eye, in_coords, parameters,
+        COLOR_BLUE, overfill_factor, interpolators);
+
+    vr::DistortionCoordinates_t coords;
+    // flip v-coordinates again
+    coords.rfRed[0] = coords_red[0];
+    coords.rfRed[1] = 1.0f - coords_red[1];
+    coords.rfGreen[0] = coords_green[0];
+    coords.rfGreen[1] = 1.0f - coords_green[1];
+    coords.rfBlue[0] = coords_blue[0];
+    coords.rfBlue[1] = 1.0f - coords_blue[1];
+
+    return coords;
+}
+
+std::size_t getDistortionTableResolution(float desired_triangles)
+{
+    // An n x n grid of nodes has 2 (n - 1)^2 triangles.
+    const auto cells = std::sqrt(std::max(desired_triangles, 2.0f) / 2.0f);
+    return static_cast<std::size_t>(std::ceil(cells)) + 1;
+}
+
+void parallelFor(std::size_t count, std::size_t threads, const std::function<void(std::size_t)>& fn)
+{
+    std::atomic<std::size_t> next { 0 };
+    const auto worker = [&] {
+        for (auto i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::future<void>> helpers;
+    for (std::size_t t = 1; t < std::min(threads, count); ++t) {
+        helpers.push_back(std::async(std::launch::async, worker));
+    }
+    worker();
+
+    // get() rethrows anything a helper threw.
+    for (auto& helper : helpers) {
+        helper.get();
+    }
+}
+
+std::size_t getDistortionBuildThreads(std::size_t requested)
+{
+    if (requested > 0)
+        return requested;
+
+    // hardware_concurrency() may return 0 if it can't tell.
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+std::vector<const MonoPointDistortionMeshDescription*> getPointSamples(const osvr::renderkit::DistortionParameters& parameters, std::size_t eye)
+{
+    using osvr::renderkit::DistortionParameters;
+
+    // The same checks, and the same order, as
+    // makeUnstructuredMeshInterpolators()
+    std::vector<const MonoPointDistortionMeshDescription*> samples;
+    if (DistortionParameters::mono_point_samples == parameters.m_type) {
+        if (eye < parameters.m_monoPointSamples.size()) {
+            samples.push_back(&parameters.m_monoPointSamples[eye]);
+        }
+    } else if (DistortionParameters::rgb_point_samples == parameters.m_type && 3 == parameters.m_rgbPointSamples.size()) {
+        for (const auto& color : parameters.m_rgbPointSamples) {
+            if (eye >= color.size())
+                return {};
+            samples.push_back(&color[eye]);
+        }
+    }
+    return samples;
+}
+
+std::vector<MeshInterpolators> makeMeshInterpolators(const std::vector<osvr::renderkit::DistortionParameters>& parameters, std::size_t threads)
+{
+    using osvr::renderkit::DistortionParameters;
+    using osvr::renderkit::UnstructuredMeshInterpolator;
+
+    // Each interpolator only depends on its own point samples, so they can
+    // all be built at once.
+    struct Job {
+        std::size_t eye;
+        std::size_t color;
+        const MonoPointDistortionMeshDescription* mesh;
+    };
+    std::vector<Job> jobs;
+
+    std::vector<MeshInterpolators> interpolators(parameters.size());
+    for (std::size_t eye = 0; eye < parameters.size(); ++eye) {
+        const auto samples = getPointSamples(parameters[eye], eye);
+        interpolators[eye].resize(samples.size());
+        for (std::size_t color = 0; color < samples.size(); ++color) {
+            jobs.push_back({ eye, color, samples[color] });
+        }
+    }
+
+    parallelFor(jobs.size(), threads, [&](std::size_t i) {
+        const auto& job = jobs[i];
+        interpolators[job.eye][job.color].reset(new UnstructuredMeshInterpolator(*job.mesh));
+    });
+
+    return interpolators;
+}
+
+double getMaxDistortionError(const DistortionFunction& distortion, const DistortionFunction& reference, std::size_t columns, std::size_t rows)
+{
+    double max_error = 0.0;
+    for (std::size_t j = 0; j < rows; ++j) {
+        const auto v = (static_cast<float>(j) + 0.5f) / static_cast<float>(rows);
+        for (std::size_t i = 0; i < columns; ++i) {
+            const auto u = (static_cast<float>(i) + 0.5f) / static_cast<float>(columns);
+            const auto expected = reference(u, v);
+            const auto actual = distortion(u, v);
+            max_error = std::max(max_error, distance(expected.rfRed, actual.rfRed));
+            max_error = std::max(max_error, distance(expected.rfGreen, actual.rfGreen));
+            max_error = std::max(max_error, distance(expected.rfBlue, actual.rfBlue));
+        }
+    }
+    return max_error;
+}
+
+double timeDistortion(const DistortionFunction& distortion, std::size_t grid, float& checksum)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t j = 0; j < grid; ++j) {
+        const auto v = static_cast<float>(j) / static_cast<float>(grid - 1);
+        for (std::size_t i = 0; i < grid; ++i) {
+            const auto u = static_cast<float>(i) / static_cast<float>(grid - 1);
+            const auto coords = distortion(u, v);
+            checksum += coords.rfRed[0] + coords.rfGreen[1] + coords.rfBlue[0];
+        }
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / static_cast<double>(grid * grid);
+}
+
+std::array<double, 4> getDistortionJacobian(const DistortionFunction& distortion, float u, float v, float step)
+{
+    const auto left = distortion(u - step, v);
+    const auto right = distortion(u + step, v);
+    const auto below = distortion(u, v - step);
+    const auto above = distortion(u, v + step);
+    const auto scale = 1.0 / (2.0 * static_cast<double>(step));
+    return { { (static_cast<double>(right.rfGreen[0]) - left.rfGreen[0]) * scale, (static_cast<double>(above.rfGreen[0]) - below.rfGreen[0]) * scale,
+        (static_cast<double>(right.rfGreen[1]) - left.rfGreen[1]) * scale, (static_cast<double>(above.rfGreen[1]) - below.rfGreen[1]) * scale } };
+}
+
+std::pair<std::uint32_t, std::uint32_t> getRenderTargetSize(const std::array<double, 4>& jacobian, std::uint32_t viewport_width, std::uint32_t viewport_height, double pixel_density)
+{
+    const auto det = jacobian[0] * jacobian[3] - jacobian[1] * jacobian[2];
+    if (std::abs(det) < 1e-12)
+        return { 0, 0 };
+
+    // The inverse maps a step in the render target back to a step on the
+    // display; scale that to display pixels. A render target pixel along each
+    // axis should cover 1 / pixel_density display pixels.
+    const auto width = static_cast<double>(viewport_width);
+    const auto height = static_cast<double>(viewport_height);
+    const auto target_width = pixel_density * std::hypot(jacobian[3] / det * width, -jacobian[2] / det * height);
+    const auto target_height = pixel_density * std::hypot(-jacobian[1] / det * width, jacobian[0] / det * height);
+    return { static_cast<std::uint32_t>(std::ceil(target_width)), static_cast<std::uint32_t>(std::ceil(target_height)) };
+}
+
+const std::size_t DistortionLookupTable::ValuesPerNode;
+
+void DistortionLookupTable::build(std::size_t width, std::size_t height, const DistortionBatchFunction& distortion, std::size_t threads)
+{
+    width_ = std::max<std::size_t>(width, 2);
+    height_ = std::max<std::size_t>(height, 2);
+    values_.resize(width_ * height_ * ValuesPerNode);
+
+    std::vector<float> us(width_);
+    for (std::size_t i = 0; i < width_; ++i) {
+        us[i] = static_cast<float>(i) / static_cast<float>(width_ - 1);
+    }
+
+    // Rows don't overlap, so each one can be filled independently.
+    parallelFor(height_, threads, [&](std::size_t j) {
+        const std::vector<float> vs(width_, static_cast<float>(j) / static_cast<float>(height_ - 1));
+
+        // Evaluate the row as a batch, then interleave it into the table.
+        std::vector<float> row(width_ * ValuesPerNode);
+        const DistortionBatch batch = { { &row[0 * width_], &row[1 * width_] }, { &row[2 * width_], &row[3 * width_] }, { &row[4 * width_], &row[5 * width_] } };
+        distortion(us.data(), vs.data(), width_, batch);
+
+        auto node = &values_[j * width_ * ValuesPerNode];
+        for (std::size_t i = 0; i < width_; ++i) {
+            for (std::size_t k = 0; k < ValuesPerNode; ++k) {
+                node[k] = row[k * width_ + i];
+            }
+            node += ValuesPerNode;
+        }
+    });
+}
+
+void DistortionLookupTable::assign(std::size_t width, std::size_t height, const float* values)
+{
+    width_ = width;
+    height_ = height;
+    values_.assign(values, values + width_ * height_ * ValuesPerNode);
+}
+
+bool DistortionLookupTable::empty() const
+{
+    return values_.empty();
+}
+
+std::size_t DistortionLookupTable::getWidth() const
+{
+    return width_;
+}
+
+std::size_t DistortionLookupTable::getHeight() const
+{
+    return height_;
+}
+
+const std::vector<float>& DistortionLookupTable::getValues() const
+{
+    return values_;
+}
+
+vr::DistortionCoordinates_t DistortionLookupTable::lookup(float u, float v) const
+{
+    const auto x = std::max(0.0f, std::min(u, 1.0f)) * static_cast<float>(width_ - 1);
+    const auto y = std::max(0.0f, std::min(v, 1.0f)) * static_cast<float>(height_ - 1);
+    const auto i = std::min(static_cast<std::size_t>(x), width_ - 2);
+    const auto j = std::min(static_cast<std::size_t>(y), height_ - 2);
+    const auto fx = x - static_cast<float>(i);
+    const auto fy = y - static_cast<float>(j);
+
+    const auto top = &values_[(j * width_ + i) * ValuesPerNode];
+    const auto bottom = top + width_ * ValuesPerNode;
+
+    float result[ValuesPerNode];
+    for (std::size_t k = 0; k < ValuesPerNode; ++k) {
+        const auto upper = top[k] + (top[k + ValuesPerNode] - top[k]) * fx;
+        const auto lower = bottom[k] + (bottom[k + ValuesPerNode] - bottom[k]) * fx;
+        result[k] = upper + (lower - upper) * fy;
+    }
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = result[0];
+    coords.rfRed[1] = result[1];
+    coords.rfGreen[0] = result[2];
+    coords.rfGreen[1] = result[3];
+    coords.rfBlue[0] = result[4];
+    coords.rfBlue[1] = result[5];
+    return coords;
+}
+
+void DistortionLookupTable::lookup(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const
+{
+    std::size_t n = 0;
+
+#ifdef OSVR_DISTORTION_SSE2
+    float* const outputs[ValuesPerNode] = { out.red[0], out.red[1], out.green[0], out.green[1], out.blue[0], out.blue[1] };
+
+    // Four points at a time. SSE2 can't gather, so the table values are
+    // loaded one by one, but the coordinate and blending math is vectorized.
+    const auto zero = _mm_setzero_ps();
+    const auto one = _mm_set1_ps(1.0f);
+    const auto scale_x = _mm_set1_ps(static_cast<float>(width_ - 1));
+    const auto scale_y = _mm_set1_ps(static_cast<float>(height_ - 1));
+    const auto max_i = _mm_set1_ps(static_cast<float>(width_ - 2));
+    const auto max_j = _mm_set1_ps(static_cast<float>(height_ - 2));
+    const auto row_stride = width_ * ValuesPerNode;
+
+    for (; n + 4 <= count; n += 4) {
+        const auto x = _mm_mul_ps(_mm_max_ps(zero, _mm_min_ps(_mm_loadu_ps(u + n), one)), scale_x);
+        const auto y = _mm_mul_ps(_mm_max_ps(zero, _mm_min_ps(_mm_loadu_ps(v + n), one)), scale_y);
+
+        // x and y are non-negative, so truncation is floor.
+        const auto i = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(x)), max_i);
+        const auto j = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(y)), max_j);
+        const auto fx = _mm_sub_ps(x, i);
+        const auto fy = _mm_sub_ps(y, j);
+
+        std::int32_t is[4];
+        std::int32_t js[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(is), _mm_cvttps_epi32(i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(js), _mm_cvttps_epi32(j));
+
+        const float* top[4];
+        for (std::size_t p = 0; p < 4; ++p) {
+            top[p] = &values_[static_cast<std::size_t>(js[p]) * row_stride + static_cast<std::size_t>(is[p]) * ValuesPerNode];
+        }
+
+        for (std::size_t k = 0; k < ValuesPerNode; ++k) {
+            const auto t0 = _mm_setr_ps(top[0][k], top[1][k], top[2][k], top[3][k]);
+            const auto t1 = _mm_setr_ps(top[0][k + ValuesPerNode], top[1][k + ValuesPerNode], top[2][k + ValuesPerNode], top[3][k + ValuesPerNode]);
+            const auto b0 = _mm_setr_ps(top[0][k + row_stride], top[1][k + row_stride], top[2][k + row_stride], top[3][k + row_stride]);
+            const auto b1 = _mm_setr_ps(top[0][k + row_stride + ValuesPerNode], top[1][k + row_stride + ValuesPerNode], top[2][k + row_stride + ValuesPerNode], top[3][k + row_stride + ValuesPerNode]);
+
+            const auto upper = _mm_add_ps(t0, _mm_mul_ps(_mm_sub_ps(t1, t0), fx));
+            const auto lower = _mm_add_ps(b0, _mm_mul_ps(_mm_sub_ps(b1, b0), fx));
+            _mm_storeu_ps(outputs[k] + n, _mm_add_ps(upper, _mm_mul_ps(_mm_sub_ps(lower, upper), fy)));
+        }
+    }
+#endif
+
+    for (; n < count; ++n) {
+        storeDistortion(lookup(u[n], v[n]), out, n);
+    }
+}
+
+double DistortionLookupTable::getMaxError(const DistortionFunction& reference) const
+{
+    return getMaxDistortionError([this](float u, float v) { return lookup(u, v); }, reference, width_ - 1, height_ - 1);
+}
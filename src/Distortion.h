@@ -0,0 +1,266 @@
+/** @file
+    @brief Lens distortion helpers for ComputeDistortion().
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_Distortion_h_GUID_E6A81C37_4D92_4B0F_8C5A_2F7B19D3E604
+#define INCLUDED_Distortion_h_GUID_E6A81C37_4D92_4B0F_8C5A_2F7B19D3E604
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+#include <osvr/Display/Display.h>
+#include <osvr/RenderKit/DistortionParameters.h>
+#include <osvr/RenderKit/UnstructuredMeshInterpolator.h>
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * RenderManager's mesh interpolators for one eye, one per color.
+ */
+using MeshInterpolators = std::vector<std::unique_ptr<osvr::renderkit::UnstructuredMeshInterpolator>>;
+
+/**
+ * A distortion function: maps SteamVR texture coordinates for one eye to the
+ * distorted coordinates for each color.
+ */
+using DistortionFunction = std::function<vr::DistortionCoordinates_t(float u, float v)>;
+
+/**
+ * The distorted coordinates of a batch of points as a structure of arrays:
+ * the u and v coordinates of each color, each with one entry per point.
+ */
+struct DistortionBatch {
+    float* red[2];
+    float* green[2];
+    float* blue[2];
+};
+
+/**
+ * A batched distortion function: computes the distortion of the @c count
+ * points (u[i], v[i]) into @c out.
+ */
+using DistortionBatchFunction = std::function<void(const float* u, const float* v, std::size_t count, const DistortionBatch& out)>;
+
+/**
+ * Returns a batch of one that writes to @c coords.
+ */
+DistortionBatch makeDistortionBatch(vr::DistortionCoordinates_t& coords);
+
+/**
+ * Stores one point's distorted coordinates at index @c i of a batch.
+ */
+inline void storeDistortion(const vr::DistortionCoordinates_t& coords, const DistortionBatch& out, std::size_t i)
+{
+    out.red[0][i] = coords.rfRed[0];
+    out.red[1][i] = coords.rfRed[1];
+    out.green[0][i] = coords.rfGreen[0];
+    out.green[1][i] = coords.rfGreen[1];
+    out.blue[0][i] = coords.rfBlue[0];
+    out.blue[1][i] = coords.rfBlue[1];
+}
+
+/**
+ * Adapts a distortion function to evaluate batches one point at a time.
+ */
+DistortionBatchFunction makeBatchFunction(DistortionFunction distortion);
+
+/**
+ * How ComputeDistortion() evaluates the distortion.
+ */
+enum class DistortionMode {
+    Interpolator, ///< interpolate the point samples, through the Mesh triangulation unless they can't be triangulated
+    Table,        ///< bilinear lookup in a table baked from the interpolators
+    Mesh,         ///< barycentric interpolation in an indexed triangulation of the samples
+    Quadtree,     ///< bilinear lookup in an adaptive quadtree baked from the interpolators
+    Polynomial    ///< closed-form polynomial model fitted to the interpolators
+};
+
+/**
+ * Parses a string into a distortion mode. Returns @c Interpolator for
+ * unrecognized values.
+ */
+DistortionMode parseDistortionMode(const std::string& str);
+
+std::ostream& operator<<(std::ostream& os, DistortionMode mode);
+
+/**
+ * Rotates a normalized (u, v) texture coordinate by a rotation
+ * (counter-clockwise).
+ */
+std::pair<float, float> rotate(float u, float v, osvr::display::Rotation rotation);
+
+/**
+ * Computes the distortion for all three colors with RenderManager's mesh
+ * interpolators.
+ *
+ * @param eye the eye (0 for left, 1 for right)
+ * @param u, v texture coordinates with (0, 0) at the upper-left corner, already
+ * rotated to match the display
+ */
+vr::DistortionCoordinates_t computeMeshDistortion(std::size_t eye, float u, float v, const osvr::renderkit::DistortionParameters& parameters, float overfill_factor, const MeshInterpolators& interpolators);
+
+/**
+ * Picks a lookup table resolution roughly as dense as a distortion mesh with
+ * the given number of triangles.
+ */
+std::size_t getDistortionTableResolution(float desired_triangles);
+
+/**
+ * Calls @c fn(i) for each i in [0, count) on up to @c threads threads,
+ * including the calling one. Returns once every call has finished.
+ */
+void parallelFor(std::size_t count, std::size_t threads, const std::function<void(std::size_t)>& fn);
+
+/**
+ * Returns the largest distance between two distortion functions for any
+ * color, measured at the centers of a @c columns by @c rows grid of cells.
+ */
+double getMaxDistortionError(const DistortionFunction& distortion, const DistortionFunction& reference, std::size_t columns, std::size_t rows);
+
+/**
+ * Evaluates @c distortion over a @c grid by @c grid set of coordinates,
+ * corners included, and returns the average time per call in nanoseconds.
+ * The results are added to @c checksum so the calls can't be optimized away.
+ */
+double timeDistortion(const DistortionFunction& distortion, std::size_t grid, float& checksum);
+
+/**
+ * Estimates the Jacobian of the green channel of @c distortion at (u, v) by
+ * central differences @c step apart.
+ *
+ * @return { du'/du, du'/dv, dv'/du, dv'/dv }, where (u', v') is the distorted
+ * coordinate
+ */
+std::array<double, 4> getDistortionJacobian(const DistortionFunction& distortion, float u, float v, float step = 1.0f / 64.0f);
+
+/**
+ * Picks a render target size giving @c pixel_density render target pixels per
+ * display pixel, in each direction, where the distortion has the given
+ * Jacobian. The eye's viewport on the display is @c viewport_width by
+ * @c viewport_height pixels.
+ *
+ * Where the lens magnifies, one display pixel covers less than a display
+ * pixel's worth of the render target, so the render target has to be larger
+ * than the viewport. Returns a zero size if the Jacobian is singular.
+ */
+std::pair<std::uint32_t, std::uint32_t> getRenderTargetSize(const std::array<double, 4>& jacobian, std::uint32_t viewport_width, std::uint32_t viewport_height, double pixel_density);
+
+/**
+ * Returns the number of threads to build distortion data with. A request of 0
+ * means one per hardware thread.
+ */
+std::size_t getDistortionBuildThreads(std::size_t requested);
+
+/**
+ * Returns the point samples of one eye: one set for mono point samples, one
+ * per color (red, green, blue) for RGB point samples, or none if the
+ * distortion isn't described by point samples.
+ */
+std::vector<const MonoPointDistortionMeshDescription*> getPointSamples(const osvr::renderkit::DistortionParameters& parameters, std::size_t eye);
+
+/**
+ * Builds RenderManager's mesh interpolators for every eye, constructing up to
+ * @c threads of them (one per eye and color) at a time.
+ *
+ * @param parameters the distortion parameters for each eye, indexed by eye
+ * @return the interpolators for each eye, empty for an eye whose parameters
+ * aren't point samples
+ */
+std::vector<MeshInterpolators> makeMeshInterpolators(const std::vector<osvr::renderkit::DistortionParameters>& parameters, std::size_t threads);
+
+/**
+ * A distortion function sampled on a regular grid over [0, 1] x [0, 1] and
+ * reconstructed by bilinear interpolation.
+ */
+class DistortionLookupTable {
+public:
+    /**
+     * Samples @c distortion on a @c width by @c height grid. Both must be at
+     * least 2.
+     *
+     * @c distortion is called once per row. With more than one thread, the
+     * rows are split between them, so it must be safe to call concurrently.
+     */
+    void build(std::size_t width, std::size_t height, const DistortionBatchFunction& distortion, std::size_t threads = 1);
+
+    /**
+     * Replaces the table with previously built values, as returned by
+     * getValues() for a table of the same dimensions.
+     */
+    void assign(std::size_t width, std::size_t height, const float* values);
+
+    /**
+     * Returns @c true if the table hasn't been built.
+     */
+    bool empty() const;
+
+    std::size_t getWidth() const;
+    std::size_t getHeight() const;
+
+    /**
+     * Returns the raw table: six floats per node (u, v for red, green and
+     * blue), with the nodes in row-major order.
+     */
+    const std::vector<float>& getValues() const;
+
+    /**
+     * Returns the interpolated distortion at (u, v). Coordinates outside
+     * [0, 1] are clamped.
+     */
+    vr::DistortionCoordinates_t lookup(float u, float v) const;
+
+    /**
+     * Looks up the interpolated distortion of the @c count points
+     * (u[i], v[i]). Uses SSE2 where available.
+     */
+    void lookup(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const;
+
+    /**
+     * Returns the largest distance between the table and @c reference for any
+     * color, measured at the center of each grid cell, where interpolation
+     * error is largest.
+     */
+    double getMaxError(const DistortionFunction& reference) const;
+
+private:
+    static const std::size_t ValuesPerNode = 6; // (u, v) for red, green, blue
+
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+    std::vector<float> values_;
+};
+
+#endif // INCLUDED_Distortion_h_GUID_E6A81C37_4D92_4B0F_8C5A_2F7B19D3E604
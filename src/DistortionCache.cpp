@@ -0,0 +1,433 @@
+/** @file
+    @brief On-disk cache of built distortion data.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionCache.h"
+#include "Logging.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char CacheMagic[8] = { 'O', 'S', 'V', 'R', 'D', 'I', 'S', 'T' };
+
+// Bump this whenever the layout or the meaning of the cached data changes.
+const std::uint32_t CacheFormatVersion = 2;
+
+/**
+ * The kind of distortion data in a cache file. The interpolator and mesh
+ * modes share the meshes.
+ */
+enum class CacheContent : std::uint32_t {
+    Tables = 1,
+    Meshes = 2,
+    Quadtrees = 3,
+    Polynomials = 4
+};
+
+/**
+ * The cache file starts with this header, followed by the payload a
+ * DistortionCacheWriter built: the left and then the right eye's data.
+ */
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t formatVersion;
+    std::uint32_t content; ///< a CacheContent
+    std::uint64_t key;
+    std::uint64_t checksum; ///< FNV-1a hash of everything after the header
+    std::uint64_t size; ///< number of bytes after the header
+};
+
+static_assert(sizeof(float) == 4, "The distortion cache stores 32-bit floats.");
+static_assert(sizeof(CacheHeader) % 8 == 0, "The payload must stay 8-byte aligned.");
+
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Returns the start of the mapping, or @c nullptr if the file couldn't be
+     * mapped.
+     */
+    const unsigned char* data() const;
+    std::size_t size() const;
+
+private:
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& path)
+{
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == file_)
+        return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || 0 == size.QuadPart)
+        return;
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_)
+        return;
+
+    data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (data_) {
+        size_ = static_cast<std::size_t>(size.QuadPart);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+    }
+    if (INVALID_HANDLE_VALUE != file_) {
+        CloseHandle(file_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        return;
+
+    struct stat status;
+    if (fstat(fd_, &status) != 0 || 0 == status.st_size)
+        return;
+
+    const auto size = static_cast<std::size_t>(status.st_size);
+    auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (MAP_FAILED != data) {
+        data_ = data;
+        size_ = size;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_) {
+        munmap(data_, size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+#endif
+
+const unsigned char* MappedFile::data() const
+{
+    return static_cast<const unsigned char*>(data_);
+}
+
+std::size_t MappedFile::size() const
+{
+    return size_;
+}
+
+} // anonymous namespace
+
+std::uint64_t fnv1aHash(const void* data, std::size_t size, std::uint64_t hash)
+{
+    const auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+namespace {
+
+/**
+ * Validates the cache file at @c path and hands its payload to @c read. The
+ * payload must be read completely.
+ */
+bool loadCache(const std::string& path, std::uint64_t key, CacheContent content, const std::function<bool(DistortionCacheReader&)>& read)
+{
+    const MappedFile file(path);
+    if (!file.data()) {
+        OSVR_LOG(debug) << "loadDistortionCache(): No distortion cache at [" << path << "].";
+        return false;
+    }
+
+    if (file.size() < sizeof(CacheHeader)) {
+        OSVR_LOG(warn) << "The distortion cache [" << path << "] is truncated. Rebuilding it.";
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0) {
+        OSVR_LOG(warn) << "The file [" << path << "] is not a distortion cache. Rebuilding it.";
+        return false;
+    }
+
+    if (header.formatVersion != CacheFormatVersion || header.content != static_cast<std::uint32_t>(content) || header.key != key) {
+        OSVR_LOG(info) << "The distortion cache [" << path << "] is out of date. Rebuilding it.";
+        return false;
+    }
+
+    const auto payload_size = file.size() - sizeof(CacheHeader);
+    if (header.size != payload_size) {
+        OSVR_LOG(warn) << "The distortion cache [" << path << "] has the wrong size. Rebuilding it.";
+        return false;
+    }
+
+    const auto payload = file.data() + sizeof(CacheHeader);
+    if (fnv1aHash(payload, payload_size) != header.checksum) {
+        OSVR_LOG(warn) << "The distortion cache [" << path << "] is corrupt. Rebuilding it.";
+        return false;
+    }
+
+    // Read straight out of the mapping.
+    DistortionCacheReader reader(payload, payload_size);
+    if (!read(reader) || !reader.atEnd()) {
+        OSVR_LOG(warn) << "The distortion cache [" << path << "] doesn't hold the expected data. Rebuilding it.";
+        return false;
+    }
+    return true;
+}
+
+bool saveCache(const std::string& path, std::uint64_t key, CacheContent content, const DistortionCacheWriter& writer)
+{
+    const auto& payload = writer.getData();
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.formatVersion = CacheFormatVersion;
+    header.content = static_cast<std::uint32_t>(content);
+    header.key = key;
+    header.checksum = fnv1aHash(payload.data(), payload.size());
+    header.size = payload.size();
+
+    // Write to a temporary file and move it into place so a crash or a
+    // concurrent reader never sees a half-written cache.
+    const auto temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        if (!out) {
+            OSVR_LOG(warn) << "Could not write the distortion cache [" << temp_path << "].";
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    // rename() won't replace an existing file on Windows.
+    std::remove(path.c_str());
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        OSVR_LOG(warn) << "Could not move the distortion cache into place at [" << path << "].";
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void writeTable(DistortionCacheWriter& writer, const DistortionLookupTable& table)
+{
+    writer.write(static_cast<std::uint64_t>(table.getWidth()));
+    writer.write(static_cast<std::uint64_t>(table.getHeight()));
+    writer.write(table.getValues());
+}
+
+bool readTable(DistortionCacheReader& reader, DistortionLookupTable& table)
+{
+    std::uint64_t width = 0;
+    std::uint64_t height = 0;
+    std::vector<float> values;
+    if (!reader.read(width) || !reader.read(height) || !reader.read(values))
+        return false;
+    const auto nodes = values.size() / 6;
+    if (width < 2 || height < 2 || values.size() % 6 != 0 || nodes % width != 0 || nodes / width != height)
+        return false;
+    table.assign(static_cast<std::size_t>(width), static_cast<std::size_t>(height), values.data());
+    return true;
+}
+
+void writeMeshes(DistortionCacheWriter& writer, const DistortionMeshes& meshes)
+{
+    writer.write(static_cast<std::uint64_t>(meshes.size()));
+    for (const auto& mesh : meshes) {
+        mesh.save(writer);
+    }
+}
+
+bool readMeshes(DistortionCacheReader& reader, DistortionMeshes& meshes)
+{
+    // One mesh, or one per color
+    std::uint64_t count = 0;
+    if (!reader.read(count) || count < 1 || count > 3)
+        return false;
+    meshes.resize(static_cast<std::size_t>(count));
+    for (auto& mesh : meshes) {
+        if (!mesh.load(reader))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Loads both eyes into temporaries so that a failed load leaves the outputs
+ * untouched.
+ */
+template <typename T, typename Read>
+bool loadEyes(const std::string& path, std::uint64_t key, CacheContent content, T& left_eye, T& right_eye, Read read)
+{
+    T left;
+    T right;
+    if (!loadCache(path, key, content, [&](DistortionCacheReader& reader) { return read(reader, left) && read(reader, right); }))
+        return false;
+    left_eye = std::move(left);
+    right_eye = std::move(right);
+    return true;
+}
+
+} // anonymous namespace
+
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionLookupTable& left_eye, DistortionLookupTable& right_eye)
+{
+    return loadEyes(path, key, CacheContent::Tables, left_eye, right_eye, readTable);
+}
+
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionMeshes& left_eye, DistortionMeshes& right_eye)
+{
+    return loadEyes(path, key, CacheContent::Meshes, left_eye, right_eye, readMeshes);
+}
+
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionQuadtree& left_eye, DistortionQuadtree& right_eye)
+{
+    return loadEyes(path, key, CacheContent::Quadtrees, left_eye, right_eye, [](DistortionCacheReader& reader, DistortionQuadtree& quadtree) { return quadtree.load(reader); });
+}
+
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionPolynomial& left_eye, DistortionPolynomial& right_eye)
+{
+    return loadEyes(path, key, CacheContent::Polynomials, left_eye, right_eye, [](DistortionCacheReader& reader, DistortionPolynomial& polynomial) { return polynomial.load(reader); });
+}
+
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionLookupTable& left_eye, const DistortionLookupTable& right_eye)
+{
+    if (left_eye.empty() || left_eye.getWidth() != right_eye.getWidth() || left_eye.getHeight() != right_eye.getHeight()) {
+        OSVR_LOG(err) << "saveDistortionCache(): The lookup tables don't match.";
+        return false;
+    }
+
+    DistortionCacheWriter writer;
+    writeTable(writer, left_eye);
+    writeTable(writer, right_eye);
+    return saveCache(path, key, CacheContent::Tables, writer);
+}
+
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionMeshes& left_eye, const DistortionMeshes& right_eye)
+{
+    const auto is_empty = [](const DistortionMeshes& meshes) { return meshes.empty() || std::any_of(meshes.begin(), meshes.end(), [](const DistortionMesh& mesh) { return mesh.empty(); }); };
+    if (is_empty(left_eye) || is_empty(right_eye)) {
+        OSVR_LOG(err) << "saveDistortionCache(): The distortion meshes are empty.";
+        return false;
+    }
+
+    DistortionCacheWriter writer;
+    writeMeshes(writer, left_eye);
+    writeMeshes(writer, right_eye);
+    return saveCache(path, key, CacheContent::Meshes, writer);
+}
+
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionQuadtree& left_eye, const DistortionQuadtree& right_eye)
+{
+    if (left_eye.empty() || right_eye.empty()) {
+        OSVR_LOG(err) << "saveDistortionCache(): The distortion quadtrees are empty.";
+        return false;
+    }
+
+    DistortionCacheWriter writer;
+    left_eye.save(writer);
+    right_eye.save(writer);
+    return saveCache(path, key, CacheContent::Quadtrees, writer);
+}
+
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionPolynomial& left_eye, const DistortionPolynomial& right_eye)
+{
+    if (left_eye.empty() || right_eye.empty()) {
+        OSVR_LOG(err) << "saveDistortionCache(): The distortion models are empty.";
+        return false;
+    }
+
+    DistortionCacheWriter writer;
+    left_eye.save(writer);
+    right_eye.save(writer);
+    return saveCache(path, key, CacheContent::Polynomials, writer);
+}
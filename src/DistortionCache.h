@@ -0,0 +1,192 @@
+/** @file
+    @brief On-disk cache of built distortion data.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionCache_h_GUID_5B2F8E61_A7C4_4D3B_9E10_6C84D2F7A935
+#define INCLUDED_DistortionCache_h_GUID_5B2F8E61_A7C4_4D3B_9E10_6C84D2F7A935
+
+// Internal Includes
+#include "Distortion.h"
+#include "DistortionMesh.h"
+#include "DistortionPolynomial.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Computes the 64-bit FNV-1a hash of a block of memory. Pass the result of a
+ * previous call as @c hash to continue hashing across several blocks.
+ */
+std::uint64_t fnv1aHash(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ULL);
+
+/**
+ * Builds the payload of a distortion cache file: a sequence of arrays of
+ * trivially copyable values, each stored as its element count followed by
+ * its bytes, padded to a multiple of 8 bytes.
+ */
+class DistortionCacheWriter {
+public:
+    template <typename T>
+    void write(const T* values, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be cached.");
+        const auto stored_count = static_cast<std::uint64_t>(count);
+        append(&stored_count, sizeof(stored_count));
+        append(values, count * sizeof(T));
+    }
+
+    template <typename T>
+    void write(const std::vector<T>& values)
+    {
+        write(values.data(), values.size());
+    }
+
+    template <typename T>
+    void write(const T& value)
+    {
+        write(&value, 1);
+    }
+
+    const std::vector<unsigned char>& getData() const
+    {
+        return data_;
+    }
+
+private:
+    void append(const void* data, std::size_t size)
+    {
+        const auto bytes = static_cast<const unsigned char*>(data);
+        data_.insert(data_.end(), bytes, bytes + size);
+        data_.resize((data_.size() + 7) / 8 * 8, 0);
+    }
+
+    std::vector<unsigned char> data_;
+};
+
+/**
+ * Reads back the arrays a DistortionCacheWriter wrote, in the same order and
+ * with the same types. Every read fails, rather than reading past the end,
+ * if the payload doesn't hold what's asked for.
+ */
+class DistortionCacheReader {
+public:
+    DistortionCacheReader(const unsigned char* data, std::size_t size) : data_(data), size_(size)
+    {
+    }
+
+    template <typename T>
+    bool read(std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be cached.");
+        std::uint64_t count = 0;
+        if (!readCount(count) || count > getRemaining() / sizeof(T))
+            return false;
+        values.resize(static_cast<std::size_t>(count));
+        return readBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be cached.");
+        std::uint64_t count = 0;
+        return readCount(count) && 1 == count && readBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Returns @c true once everything has been read.
+     */
+    bool atEnd() const
+    {
+        return offset_ == size_;
+    }
+
+private:
+    std::size_t getRemaining() const
+    {
+        return size_ - offset_;
+    }
+
+    bool readCount(std::uint64_t& count)
+    {
+        return readBytes(&count, sizeof(count));
+    }
+
+    bool readBytes(void* out, std::size_t size)
+    {
+        const auto padded = (size + 7) / 8 * 8;
+        if (padded > getRemaining())
+            return false;
+        if (size > 0) {
+            std::memcpy(out, data_ + offset_, size);
+        }
+        offset_ += padded;
+        return true;
+    }
+
+    const unsigned char* data_;
+    std::size_t size_;
+    std::size_t offset_ = 0;
+};
+
+/**
+ * Loads the distortion data for both eyes from a distortion cache file.
+ *
+ * The file is memory-mapped and validated before anything is copied out of
+ * it. A missing file, one written for a different @c key, for a different
+ * kind of distortion data or by a different version of the cache format, or
+ * one whose contents don't match its checksum is rejected, leaving the
+ * outputs untouched; the caller should rebuild the data and save it again.
+ *
+ * @param path the cache file
+ * @param key a hash of everything the data was built from
+ * @return @c true if the data for both eyes was loaded
+ */
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionLookupTable& left_eye, DistortionLookupTable& right_eye);
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionMeshes& left_eye, DistortionMeshes& right_eye);
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionQuadtree& left_eye, DistortionQuadtree& right_eye);
+bool loadDistortionCache(const std::string& path, std::uint64_t key, DistortionPolynomial& left_eye, DistortionPolynomial& right_eye);
+
+/**
+ * Writes the distortion data for both eyes to a distortion cache file,
+ * replacing any existing one. Neither eye's data may be empty, and lookup
+ * tables must have the same dimensions.
+ *
+ * @return @c true on success
+ */
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionLookupTable& left_eye, const DistortionLookupTable& right_eye);
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionMeshes& left_eye, const DistortionMeshes& right_eye);
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionQuadtree& left_eye, const DistortionQuadtree& right_eye);
+bool saveDistortionCache(const std::string& path, std::uint64_t key, const DistortionPolynomial& left_eye, const DistortionPolynomial& right_eye);
+
+#endif // INCLUDED_DistortionCache_h_GUID_5B2F8E61_A7C4_4D3B_9E10_6C84D2F7A935
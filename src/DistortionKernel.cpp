@@ -0,0 +1,174 @@
+/** @file
+    @brief Distortion kernels specialized for each display rotation and eye.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionKernel.h"
+#include "Logging.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cstddef>
+
+namespace {
+
+using Rotation = osvr::display::Rotation;
+
+/**
+ * Rotates normalized coordinates counter-clockwise, like rotate(), with the
+ * rotation known at compile time.
+ */
+template <Rotation R>
+struct Rotate;
+
+template <>
+struct Rotate<Rotation::Zero> {
+    static void apply(float&, float&)
+    {
+        // do nothing
+    }
+};
+
+template <>
+struct Rotate<Rotation::Ninety> {
+    static void apply(float& u, float& v)
+    {
+        const auto rotated_u = 1.0f - v;
+        v = u;
+        u = rotated_u;
+    }
+};
+
+template <>
+struct Rotate<Rotation::OneEighty> {
+    static void apply(float& u, float& v)
+    {
+        u = 1.0f - u;
+        v = 1.0f - v;
+    }
+};
+
+template <>
+struct Rotate<Rotation::TwoSeventy> {
+    static void apply(float& u, float& v)
+    {
+        const auto rotated_u = v;
+        v = 1.0f - u;
+        u = rotated_u;
+    }
+};
+
+template <Rotation R, std::size_t Eye>
+void interpolatorKernel(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    const auto& parameters = *source.parameters;
+    const auto& interpolators = *source.interpolators;
+    const auto overfill_factor = source.overfillFactor;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto rotated_u = u[i];
+        auto rotated_v = v[i];
+        Rotate<R>::apply(rotated_u, rotated_v);
+        storeDistortion(computeMeshDistortion(Eye, rotated_u, rotated_v, parameters, overfill_factor, interpolators), out, i);
+    }
+}
+
+template <Rotation R>
+void meshKernel(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    const auto& meshes = *source.meshes;
+    const auto overfill_factor = source.overfillFactor;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto rotated_u = u[i];
+        auto rotated_v = v[i];
+        Rotate<R>::apply(rotated_u, rotated_v);
+        storeDistortion(interpolateDistortion(rotated_u, rotated_v, meshes, overfill_factor), out, i);
+    }
+}
+
+void tableKernel(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    source.table->lookup(u, v, count, out);
+}
+
+void quadtreeKernel(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    source.quadtree->lookup(u, v, count, out);
+}
+
+void polynomialKernel(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    source.polynomial->evaluate(u, v, count, out);
+}
+
+void identityKernel(const DistortionSource&, const float* u, const float* v, std::size_t count, const DistortionBatch& out)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        out.red[0][i] = out.green[0][i] = out.blue[0][i] = u[i];
+        out.red[1][i] = out.green[1][i] = out.blue[1][i] = v[i];
+    }
+}
+
+template <Rotation R>
+DistortionKernel getKernel(DistortionMode mode, std::size_t eye)
+{
+    switch (mode) {
+    case DistortionMode::Table:
+        return &tableKernel;
+    case DistortionMode::Mesh:
+        // The meshes are per eye already.
+        return &meshKernel<R>;
+    case DistortionMode::Quadtree:
+        return &quadtreeKernel;
+    case DistortionMode::Polynomial:
+        return &polynomialKernel;
+    case DistortionMode::Interpolator:
+        break;
+    }
+    return (0 == eye) ? &interpolatorKernel<R, 0> : &interpolatorKernel<R, 1>;
+}
+
+} // anonymous namespace
+
+DistortionKernel getDistortionKernel(DistortionMode mode, osvr::display::Rotation rotation, std::size_t eye)
+{
+    switch (rotation) {
+    case Rotation::Zero:
+        return getKernel<Rotation::Zero>(mode, eye);
+    case Rotation::Ninety:
+        return getKernel<Rotation::Ninety>(mode, eye);
+    case Rotation::OneEighty:
+        return getKernel<Rotation::OneEighty>(mode, eye);
+    case Rotation::TwoSeventy:
+        return getKernel<Rotation::TwoSeventy>(mode, eye);
+    }
+    OSVR_LOG(err) << "Unknown rotation [" << rotation << "] Assuming 0 degrees.";
+    return getKernel<Rotation::Zero>(mode, eye);
+}
+
+DistortionKernel getIdentityDistortionKernel()
+{
+    return &identityKernel;
+}
@@ -0,0 +1,81 @@
+/** @file
+    @brief Distortion kernels specialized for each display rotation and eye.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionKernel_h_GUID_5B2E8F14_C7A3_4D69_9E01_63D4A8B2F7C5
+#define INCLUDED_DistortionKernel_h_GUID_5B2E8F14_C7A3_4D69_9E01_63D4A8B2F7C5
+
+// Internal Includes
+#include "Distortion.h"
+#include "DistortionMesh.h"
+#include "DistortionPolynomial.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+#include <osvr/Display/Display.h>
+#include <osvr/RenderKit/DistortionParameters.h>
+
+// Standard includes
+#include <cstddef>
+
+/**
+ * The distortion data of one eye that a kernel reads. Only the members for
+ * the kernel's mode need to be set.
+ */
+struct DistortionSource {
+    const osvr::renderkit::DistortionParameters* parameters = nullptr;
+    const MeshInterpolators* interpolators = nullptr;
+    const DistortionLookupTable* table = nullptr;
+    const DistortionMeshes* meshes = nullptr;
+    const DistortionQuadtree* quadtree = nullptr;
+    const DistortionPolynomial* polynomial = nullptr;
+    float overfillFactor = 1.0f;
+};
+
+/**
+ * Computes the distortion of the @c count points (u[i], v[i]), given in
+ * SteamVR's texture coordinates, into @c out.
+ *
+ * Each kernel has its display rotation and eye compiled in, so once one has
+ * been picked, computing the distortion doesn't look at either of them
+ * again.
+ */
+using DistortionKernel = void (*)(const DistortionSource& source, const float* u, const float* v, std::size_t count, const DistortionBatch& out);
+
+/**
+ * Returns the kernel for a distortion mode, display rotation and eye (0 for
+ * left, 1 for right).
+ *
+ * The lookup tables, quadtrees and polynomials are fitted in SteamVR's
+ * coordinates, so their kernels are the same for every rotation and eye.
+ */
+DistortionKernel getDistortionKernel(DistortionMode mode, osvr::display::Rotation rotation, std::size_t eye);
+
+/**
+ * Returns a kernel that leaves the coordinates undistorted, for use before
+ * the distortion has been set up.
+ */
+DistortionKernel getIdentityDistortionKernel();
+
+#endif // INCLUDED_DistortionKernel_h_GUID_5B2E8F14_C7A3_4D69_9E01_63D4A8B2F7C5
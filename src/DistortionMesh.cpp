@@ -0,0 +1,734 @@
+/** @file
+    @brief Triangulated distortion point samples with a spatial index.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionMesh.h"
+#include "DistortionCache.h"
+#include "osvr_compiler_detection.h" // for OSVR_THREAD_LOCAL
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Point {
+    double x;
+    double y;
+};
+
+struct Circle {
+    double x;
+    double y;
+    double radiusSquared;
+};
+
+struct WorkTriangle {
+    std::array<std::uint32_t, 3> vertices;
+    Circle circumcircle;
+};
+
+Circle getCircumcircle(const Point& a, const Point& b, const Point& c)
+{
+    const auto d = 2.0 * (a.x * (b.y - c.y) + b.x * (c.y - a.y) + c.x * (a.y - b.y));
+    const auto a2 = a.x * a.x + a.y * a.y;
+    const auto b2 = b.x * b.x + b.y * b.y;
+    const auto c2 = c.x * c.x + c.y * c.y;
+
+    Circle circle;
+    circle.x = (a2 * (b.y - c.y) + b2 * (c.y - a.y) + c2 * (a.y - b.y)) / d;
+    circle.y = (a2 * (c.x - b.x) + b2 * (a.x - c.x) + c2 * (b.x - a.x)) / d;
+    circle.radiusSquared = (a.x - circle.x) * (a.x - circle.x) + (a.y - circle.y) * (a.y - circle.y);
+    return circle;
+}
+
+/**
+ * Computes the Delaunay triangulation of a set of distinct points, sorted by
+ * x, with the Bowyer-Watson algorithm.
+ */
+std::vector<std::array<std::uint32_t, 3>> triangulate(std::vector<Point> points)
+{
+    const auto count = static_cast<std::uint32_t>(points.size());
+    if (count < 3)
+        return {};
+
+    // Work in a unit-sized frame centered on the points to keep the
+    // circumcircle computations well-conditioned.
+    auto min_x = points[0].x;
+    auto max_x = points[0].x;
+    auto min_y = points[0].y;
+    auto max_y = points[0].y;
+    for (const auto& point : points) {
+        min_x = std::min(min_x, point.x);
+        max_x = std::max(max_x, point.x);
+        min_y = std::min(min_y, point.y);
+        max_y = std::max(max_y, point.y);
+    }
+    const auto center_x = 0.5 * (min_x + max_x);
+    const auto center_y = 0.5 * (min_y + max_y);
+    const auto scale = std::max(max_x - min_x, max_y - min_y);
+    if (scale <= 0.0)
+        return {};
+    for (auto& point : points) {
+        point.x = (point.x - center_x) / scale;
+        point.y = (point.y - center_y) / scale;
+    }
+
+    // Start with a triangle that contains every point.
+    const double size = 50.0;
+    points.push_back({ -size, -size });
+    points.push_back({ size, -size });
+    points.push_back({ 0.0, size });
+
+    std::vector<WorkTriangle> triangles;
+    triangles.push_back({ { { count, count + 1, count + 2 } }, getCircumcircle(points[count], points[count + 1], points[count + 2]) });
+
+    std::vector<WorkTriangle> finished;
+    using Edge = std::pair<std::uint32_t, std::uint32_t>;
+    std::vector<Edge> edges;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const auto& point = points[i];
+
+        // Remove every triangle whose circumcircle contains the point...
+        edges.clear();
+        for (std::size_t t = 0; t < triangles.size();) {
+            const auto& circle = triangles[t].circumcircle;
+            const auto dx = point.x - circle.x;
+            const auto dy = point.y - circle.y;
+            if (dx > 0.0 && dx * dx > circle.radiusSquared) {
+                // The points come in order of x, so no later point can be
+                // inside this circumcircle either.
+                finished.push_back(triangles[t]);
+                triangles[t] = triangles.back();
+                triangles.pop_back();
+            } else if (dx * dx + dy * dy < circle.radiusSquared * (1.0 - 1e-12)) {
+                const auto& v = triangles[t].vertices;
+                edges.emplace_back(std::min(v[0], v[1]), std::max(v[0], v[1]));
+                edges.emplace_back(std::min(v[1], v[2]), std::max(v[1], v[2]));
+                edges.emplace_back(std::min(v[2], v[0]), std::max(v[2], v[0]));
+                triangles[t] = triangles.back();
+                triangles.pop_back();
+            } else {
+                ++t;
+            }
+        }
+
+        // ...and fill the hole they leave with a fan around the point. Edges
+        // shared by two removed triangles are inside the hole.
+        std::sort(edges.begin(), edges.end());
+        for (std::size_t e = 0; e < edges.size(); ++e) {
+            if (e + 1 < edges.size() && edges[e] == edges[e + 1]) {
+                ++e;
+                continue;
+            }
+            const auto a = edges[e].first;
+            const auto b = edges[e].second;
+            triangles.push_back({ { { a, b, i } }, getCircumcircle(points[a], points[b], point) });
+        }
+    }
+
+    finished.insert(finished.end(), triangles.begin(), triangles.end());
+
+    std::vector<std::array<std::uint32_t, 3>> result;
+    result.reserve(finished.size());
+    for (const auto& triangle : finished) {
+        const auto& v = triangle.vertices;
+        if (v[0] < count && v[1] < count && v[2] < count) {
+            result.push_back(v);
+        }
+    }
+    return result;
+}
+
+/**
+ * Returns @c true if two sets of samples have the same input points in the
+ * same order.
+ */
+bool haveSameInputPoints(const MonoPointDistortionMeshDescription& a, const MonoPointDistortionMeshDescription& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i][0] != b[i][0])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Finds the neighbours of each triangle. Neighbour k is the triangle across
+ * the edge opposite vertex k, or @c none if that edge is on the hull.
+ */
+std::vector<std::array<std::uint32_t, 3>> findNeighbours(const std::vector<std::array<std::uint32_t, 3>>& triangles, std::uint32_t none)
+{
+    struct Edge {
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t triangle;
+        std::uint32_t side;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(3 * triangles.size());
+    for (std::uint32_t t = 0; t < triangles.size(); ++t) {
+        const auto& v = triangles[t];
+        for (std::uint32_t side = 0; side < 3; ++side) {
+            const auto a = v[side];
+            const auto b = v[(side + 1) % 3];
+            edges.push_back({ std::min(a, b), std::max(a, b), t, side });
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return (x.a != y.a) ? (x.a < y.a) : (x.b < y.b); });
+
+    std::vector<std::array<std::uint32_t, 3>> neighbours(triangles.size(), std::array<std::uint32_t, 3> { { none, none, none } });
+    for (std::size_t e = 0; e + 1 < edges.size(); ++e) {
+        const auto& first = edges[e];
+        const auto& second = edges[e + 1];
+        if (first.a == second.a && first.b == second.b) {
+            // Side s runs from vertex s to vertex s + 1.
+            neighbours[first.triangle][(first.side + 2) % 3] = second.triangle;
+            neighbours[second.triangle][(second.side + 2) % 3] = first.triangle;
+            ++e;
+        }
+    }
+    return neighbours;
+}
+
+// Barycentric coordinates can be slightly negative on a shared edge.
+const float Tolerance = 1e-5f;
+
+/**
+ * The last triangle a thread found in a mesh. The mesh is only used as a key:
+ * the triangle is just a guess that gets tested before it is used, so an entry
+ * left behind by a destroyed mesh is harmless.
+ */
+struct CachedTriangle {
+    const void* mesh;
+    std::uint32_t triangle;
+};
+
+// Enough for three meshes per eye
+const std::size_t CacheSlots = 8;
+const std::uint32_t NoTriangle = 0xffffffff;
+
+OSVR_THREAD_LOCAL CachedTriangle cachedTriangles[CacheSlots];
+OSVR_THREAD_LOCAL std::size_t nextCacheSlot;
+
+std::uint32_t& getCachedTriangle(const void* mesh)
+{
+    for (auto& entry : cachedTriangles) {
+        if (entry.mesh == mesh)
+            return entry.triangle;
+    }
+
+    auto& entry = cachedTriangles[nextCacheSlot];
+    nextCacheSlot = (nextCacheSlot + 1) % CacheSlots;
+    entry.mesh = mesh;
+    entry.triangle = NoTriangle;
+    return entry.triangle;
+}
+
+} // anonymous namespace
+
+const std::size_t DistortionMesh::ValuesPerChannel;
+const std::uint32_t DistortionMesh::NoNeighbour;
+
+DistortionMesh::Counter::Counter(const Counter& other) : value(other.value.load(std::memory_order_relaxed))
+{
+    // do nothing
+}
+
+DistortionMesh::Counter& DistortionMesh::Counter::operator=(const Counter& other)
+{
+    value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+void DistortionMesh::Counter::increment() const
+{
+    // Not an atomic increment: this is on the lookup path, and an occasional
+    // lost count doesn't matter.
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void DistortionMesh::build(const MonoPointDistortionMeshDescription& samples)
+{
+    build(std::vector<const MonoPointDistortionMeshDescription*> { &samples });
+}
+
+void DistortionMesh::build(const std::vector<const MonoPointDistortionMeshDescription*>& channels)
+{
+    triangles_.clear();
+    neighbours_.clear();
+    values_.clear();
+    cellStart_.clear();
+    cellTriangles_.clear();
+    channels_ = 0;
+    columns_ = 0;
+    rows_ = 0;
+    resetCacheStatistics();
+
+    if (channels.empty())
+        return;
+    const auto& first = *channels.front();
+    if (!std::all_of(channels.begin(), channels.end(), [&first](const MonoPointDistortionMeshDescription* channel) { return haveSameInputPoints(*channel, first); }))
+        return;
+
+    // Sort by input point (x first) so duplicates are adjacent and
+    // triangulate() gets the order it needs.
+    std::vector<std::size_t> order(first.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&first](std::size_t a, std::size_t b) { return first[a][0] < first[b][0]; });
+    order.erase(std::unique(order.begin(), order.end(), [&first](std::size_t a, std::size_t b) { return first[a][0] == first[b][0]; }), order.end());
+
+    std::vector<Point> points;
+    points.reserve(order.size());
+    for (const auto index : order) {
+        points.push_back({ first[index][0][0], first[index][0][1] });
+    }
+
+    const auto vertices = triangulate(points);
+    if (vertices.empty())
+        return;
+
+    auto min_u = std::numeric_limits<double>::max();
+    auto min_v = std::numeric_limits<double>::max();
+    auto max_u = std::numeric_limits<double>::lowest();
+    auto max_v = std::numeric_limits<double>::lowest();
+    for (const auto& point : points) {
+        min_u = std::min(min_u, point.x);
+        min_v = std::min(min_v, point.y);
+        max_u = std::max(max_u, point.x);
+        max_v = std::max(max_v, point.y);
+    }
+    const auto scale = std::max(max_u - min_u, max_v - min_v);
+
+    // Precompute what interpolation needs, dropping degenerate (collinear)
+    // triangles. Keep the bounding box of each triangle for the index.
+    std::vector<std::array<double, 4>> bounds;
+    std::vector<std::array<std::uint32_t, 3>> kept;
+    triangles_.reserve(vertices.size());
+    bounds.reserve(vertices.size());
+    for (const auto& triangle : vertices) {
+        const auto ia = order[triangle[0]];
+        const auto ib = order[triangle[1]];
+        const auto ic = order[triangle[2]];
+        const auto& a = first[ia][0];
+        const auto& b = first[ib][0];
+        const auto& c = first[ic][0];
+
+        const auto m00 = b[0] - a[0];
+        const auto m01 = c[0] - a[0];
+        const auto m10 = b[1] - a[1];
+        const auto m11 = c[1] - a[1];
+        const auto det = m00 * m11 - m01 * m10;
+        if (std::abs(det) <= 1e-12 * scale * scale)
+            continue;
+
+        Triangle t;
+        t.origin[0] = static_cast<float>(a[0]);
+        t.origin[1] = static_cast<float>(a[1]);
+        t.inverse[0] = static_cast<float>(m11 / det);
+        t.inverse[1] = static_cast<float>(-m01 / det);
+        t.inverse[2] = static_cast<float>(-m10 / det);
+        t.inverse[3] = static_cast<float>(m00 / det);
+        triangles_.push_back(t);
+        kept.push_back(triangle);
+
+        for (const auto channel : channels) {
+            const auto& out_a = (*channel)[ia][1];
+            const auto& out_b = (*channel)[ib][1];
+            const auto& out_c = (*channel)[ic][1];
+            values_.push_back(static_cast<float>(out_a[0]));
+            values_.push_back(static_cast<float>(out_a[1]));
+            values_.push_back(static_cast<float>(out_b[0] - out_a[0]));
+            values_.push_back(static_cast<float>(out_b[1] - out_a[1]));
+            values_.push_back(static_cast<float>(out_c[0] - out_a[0]));
+            values_.push_back(static_cast<float>(out_c[1] - out_a[1]));
+        }
+
+        bounds.push_back({ { std::min({ a[0], b[0], c[0] }), std::min({ a[1], b[1], c[1] }),
+            std::max({ a[0], b[0], c[0] }), std::max({ a[1], b[1], c[1] }) } });
+    }
+    if (triangles_.empty())
+        return;
+    channels_ = channels.size();
+    neighbours_ = findNeighbours(kept, NoNeighbour);
+
+    // Size the grid so each cell overlaps a few triangles.
+    const auto side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(triangles_.size()))));
+    columns_ = std::max<std::size_t>(side, 1);
+    rows_ = columns_;
+    minU_ = static_cast<float>(min_u);
+    minV_ = static_cast<float>(min_v);
+    cellsPerU_ = (max_u > min_u) ? static_cast<float>(columns_ / (max_u - min_u)) : 0.0f;
+    cellsPerV_ = (max_v > min_v) ? static_cast<float>(rows_ / (max_v - min_v)) : 0.0f;
+
+    const auto cell_range = [&](const std::array<double, 4>& box) {
+        const auto to_column = [&](double u) { return std::min(static_cast<std::size_t>(std::max(0.0, (u - min_u) * cellsPerU_)), columns_ - 1); };
+        const auto to_row = [&](double v) { return std::min(static_cast<std::size_t>(std::max(0.0, (v - min_v) * cellsPerV_)), rows_ - 1); };
+        return std::array<std::size_t, 4> { { to_column(box[0]), to_row(box[1]), to_column(box[2]), to_row(box[3]) } };
+    };
+
+    // Counting pass, then fill
+    cellStart_.assign(columns_ * rows_ + 1, 0);
+    for (const auto& box : bounds) {
+        const auto range = cell_range(box);
+        for (auto row = range[1]; row <= range[3]; ++row) {
+            for (auto column = range[0]; column <= range[2]; ++column) {
+                ++cellStart_[row * columns_ + column + 1];
+            }
+        }
+    }
+    for (std::size_t c = 1; c < cellStart_.size(); ++c) {
+        cellStart_[c] += cellStart_[c - 1];
+    }
+
+    cellTriangles_.resize(cellStart_.back());
+    auto next = cellStart_;
+    for (std::size_t t = 0; t < bounds.size(); ++t) {
+        const auto range = cell_range(bounds[t]);
+        for (auto row = range[1]; row <= range[3]; ++row) {
+            for (auto column = range[0]; column <= range[2]; ++column) {
+                cellTriangles_[next[row * columns_ + column]++] = static_cast<std::uint32_t>(t);
+            }
+        }
+    }
+
+    // The meshes live as long as the HMD does, so don't leave them
+    // over-allocated: degenerate triangles were dropped after reserving, and
+    // the values grew one at a time.
+    triangles_.shrink_to_fit();
+    values_.shrink_to_fit();
+}
+
+bool DistortionMesh::empty() const
+{
+    return triangles_.empty();
+}
+
+std::size_t DistortionMesh::getTriangleCount() const
+{
+    return triangles_.size();
+}
+
+std::size_t DistortionMesh::getChannelCount() const
+{
+    return channels_;
+}
+
+std::size_t DistortionMesh::getMemoryUsage() const
+{
+    return triangles_.capacity() * sizeof(Triangle) + neighbours_.capacity() * sizeof(neighbours_[0]) + values_.capacity() * sizeof(float)
+        + cellStart_.capacity() * sizeof(std::uint32_t) + cellTriangles_.capacity() * sizeof(std::uint32_t);
+}
+
+DistortionMesh::CacheStatistics DistortionMesh::getCacheStatistics() const
+{
+    return { cacheHits_.value.load(std::memory_order_relaxed), cacheMisses_.value.load(std::memory_order_relaxed) };
+}
+
+void DistortionMesh::resetCacheStatistics()
+{
+    cacheHits_.value.store(0, std::memory_order_relaxed);
+    cacheMisses_.value.store(0, std::memory_order_relaxed);
+}
+
+void DistortionMesh::save(DistortionCacheWriter& writer) const
+{
+    writer.write(triangles_);
+    writer.write(neighbours_);
+    writer.write(values_);
+    writer.write(static_cast<std::uint64_t>(channels_));
+    writer.write(std::array<float, 4> { { minU_, minV_, cellsPerU_, cellsPerV_ } });
+    writer.write(static_cast<std::uint64_t>(columns_));
+    writer.write(static_cast<std::uint64_t>(rows_));
+    writer.write(cellStart_);
+    writer.write(cellTriangles_);
+}
+
+bool DistortionMesh::load(DistortionCacheReader& reader)
+{
+    DistortionMesh mesh;
+    std::uint64_t channels = 0;
+    std::array<float, 4> grid;
+    std::uint64_t columns = 0;
+    std::uint64_t rows = 0;
+    if (!reader.read(mesh.triangles_) || !reader.read(mesh.neighbours_) || !reader.read(mesh.values_) || !reader.read(channels) || !reader.read(grid)
+        || !reader.read(columns) || !reader.read(rows) || !reader.read(mesh.cellStart_) || !reader.read(mesh.cellTriangles_))
+        return false;
+
+    // The checksum has already ruled out corruption, so only check that the
+    // arrays fit together well enough for lookups to stay in bounds.
+    const auto triangles = mesh.triangles_.size();
+    if (0 == triangles || channels < 1 || channels > 3 || 0 == columns || 0 == rows || columns > mesh.cellStart_.size() || rows > mesh.cellStart_.size() || mesh.neighbours_.size() != triangles
+        || mesh.values_.size() != triangles * channels * ValuesPerChannel || mesh.cellStart_.size() != columns * rows + 1 || mesh.cellStart_.back() != mesh.cellTriangles_.size())
+        return false;
+    const auto is_triangle = [triangles](std::uint32_t index) { return index < triangles; };
+    if (!std::all_of(mesh.cellTriangles_.begin(), mesh.cellTriangles_.end(), is_triangle))
+        return false;
+    for (const auto& neighbours : mesh.neighbours_) {
+        for (const auto neighbour : neighbours) {
+            if (NoNeighbour != neighbour && !is_triangle(neighbour))
+                return false;
+        }
+    }
+
+    mesh.channels_ = static_cast<std::size_t>(channels);
+    mesh.minU_ = grid[0];
+    mesh.minV_ = grid[1];
+    mesh.cellsPerU_ = grid[2];
+    mesh.cellsPerV_ = grid[3];
+    mesh.columns_ = static_cast<std::size_t>(columns);
+    mesh.rows_ = static_cast<std::size_t>(rows);
+    *this = std::move(mesh);
+    return true;
+}
+
+std::array<float, 2> DistortionMesh::interpolate(float u, float v) const
+{
+    const auto index = findTriangle(u, v);
+    const auto& t = triangles_[index];
+    const auto du = u - t.origin[0];
+    const auto dv = v - t.origin[1];
+    const auto l1 = t.inverse[0] * du + t.inverse[1] * dv;
+    const auto l2 = t.inverse[2] * du + t.inverse[3] * dv;
+
+    const auto values = &values_[index * channels_ * ValuesPerChannel];
+    return { { values[0] + l1 * values[2] + l2 * values[4], values[1] + l1 * values[3] + l2 * values[5] } };
+}
+
+void DistortionMesh::interpolate(float u, float v, float* result) const
+{
+    const auto index = findTriangle(u, v);
+    const auto& t = triangles_[index];
+    const auto du = u - t.origin[0];
+    const auto dv = v - t.origin[1];
+    const auto l1 = t.inverse[0] * du + t.inverse[1] * dv;
+    const auto l2 = t.inverse[2] * du + t.inverse[3] * dv;
+
+    // Every channel shares the triangle and barycentric coordinates.
+    auto values = &values_[index * channels_ * ValuesPerChannel];
+    for (std::size_t channel = 0; channel < channels_; ++channel) {
+        result[0] = values[0] + l1 * values[2] + l2 * values[4];
+        result[1] = values[1] + l1 * values[3] + l2 * values[5];
+        result += 2;
+        values += ValuesPerChannel;
+    }
+}
+
+float DistortionMesh::getInsideScore(std::size_t index, float u, float v) const
+{
+    const auto& t = triangles_[index];
+    const auto du = u - t.origin[0];
+    const auto dv = v - t.origin[1];
+    const auto l1 = t.inverse[0] * du + t.inverse[1] * dv;
+    const auto l2 = t.inverse[2] * du + t.inverse[3] * dv;
+    return std::min({ l1, l2, 1.0f - l1 - l2 });
+}
+
+std::size_t DistortionMesh::findTriangle(float u, float v) const
+{
+    // Consecutive queries nearly always land in the same triangle or one a
+    // step or two away, so walk from the last one towards the point: across
+    // the edge opposite the vertex with the most negative barycentric
+    // coordinate. A walk that leaves the mesh or takes too long is a miss.
+    static const std::size_t MaxSteps = 4;
+
+    auto& last = getCachedTriangle(this);
+    auto index = last;
+    for (std::size_t step = 0; step < MaxSteps && index < triangles_.size(); ++step) {
+        const auto& t = triangles_[index];
+        const auto du = u - t.origin[0];
+        const auto dv = v - t.origin[1];
+        const auto l1 = t.inverse[0] * du + t.inverse[1] * dv;
+        const auto l2 = t.inverse[2] * du + t.inverse[3] * dv;
+        const float coordinates[3] = { 1.0f - l1 - l2, l1, l2 };
+
+        const auto vertex = std::min_element(coordinates, coordinates + 3) - coordinates;
+        if (coordinates[vertex] >= -Tolerance) {
+            cacheHits_.increment();
+            last = index;
+            return index;
+        }
+        index = neighbours_[index][vertex];
+    }
+
+    cacheMisses_.increment();
+    const auto found = searchTriangle(u, v);
+    last = static_cast<std::uint32_t>(found);
+    return found;
+}
+
+std::size_t DistortionMesh::searchTriangle(float u, float v) const
+{
+    const auto clamp = [](float x, std::size_t count) { return static_cast<std::ptrdiff_t>(std::min(std::max(x, 0.0f), static_cast<float>(count - 1))); };
+    const auto column = clamp((u - minU_) * cellsPerU_, columns_);
+    const auto row = clamp((v - minV_) * cellsPerV_, rows_);
+
+    // Search outwards in square rings of cells. The first ring with any
+    // triangles in it is nearly always the first one and has the
+    // containing triangle if there is one; otherwise extrapolate from the
+    // triangle in that ring the point is least far outside of.
+    std::size_t best = 0;
+    auto best_score = -std::numeric_limits<float>::max();
+    const auto max_ring = static_cast<std::ptrdiff_t>(std::max(columns_, rows_));
+    for (std::ptrdiff_t ring = 0; ring <= max_ring; ++ring) {
+        auto found = false;
+        for (auto r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= static_cast<std::ptrdiff_t>(rows_))
+                continue;
+            for (auto c = column - ring; c <= column + ring; ++c) {
+                if (c < 0 || c >= static_cast<std::ptrdiff_t>(columns_))
+                    continue;
+                if (std::abs(r - row) != ring && std::abs(c - column) != ring)
+                    continue;
+
+                const auto cell = static_cast<std::size_t>(r) * columns_ + static_cast<std::size_t>(c);
+                for (auto i = cellStart_[cell]; i < cellStart_[cell + 1]; ++i) {
+                    const auto index = cellTriangles_[i];
+                    const auto score = getInsideScore(index, u, v);
+                    if (score >= -Tolerance)
+                        return index;
+                    if (score > best_score) {
+                        best_score = score;
+                        best = index;
+                    }
+                    found = true;
+                }
+            }
+        }
+        if (found)
+            break;
+    }
+
+    return best;
+}
+
+std::vector<DistortionMeshes> makeDistortionMeshes(const std::vector<osvr::renderkit::DistortionParameters>& parameters, std::size_t threads)
+{
+    struct Job {
+        std::size_t eye;
+        std::size_t mesh;
+        std::vector<const MonoPointDistortionMeshDescription*> channels;
+    };
+    std::vector<Job> jobs;
+
+    std::vector<DistortionMeshes> meshes(parameters.size());
+    for (std::size_t eye = 0; eye < parameters.size(); ++eye) {
+        const auto samples = getPointSamples(parameters[eye], eye);
+        if (samples.empty())
+            continue;
+
+        // Lenses without chromatic correction only need one channel.
+        const auto achromatic = std::all_of(samples.begin(), samples.end(), [&samples](const MonoPointDistortionMeshDescription* color) { return *color == *samples.front(); });
+
+        // The colors are usually sampled at the same points, so one
+        // triangulation serves all three.
+        const auto shared = std::all_of(samples.begin(), samples.end(), [&samples](const MonoPointDistortionMeshDescription* color) { return haveSameInputPoints(*color, *samples.front()); });
+
+        if (achromatic) {
+            meshes[eye].resize(1);
+            jobs.push_back({ eye, 0, { samples.front() } });
+        } else if (shared) {
+            meshes[eye].resize(1);
+            jobs.push_back({ eye, 0, samples });
+        } else {
+            meshes[eye].resize(samples.size());
+            for (std::size_t color = 0; color < samples.size(); ++color) {
+                jobs.push_back({ eye, color, { samples[color] } });
+            }
+        }
+    }
+
+    parallelFor(jobs.size(), threads, [&](std::size_t i) {
+        const auto& job = jobs[i];
+        meshes[job.eye][job.mesh].build(job.channels);
+    });
+
+    // A mesh that couldn't be triangulated is as good as none.
+    for (auto& eye_meshes : meshes) {
+        if (std::any_of(eye_meshes.begin(), eye_meshes.end(), [](const DistortionMesh& mesh) { return mesh.empty(); })) {
+            eye_meshes.clear();
+        }
+    }
+
+    return meshes;
+}
+
+vr::DistortionCoordinates_t interpolateDistortion(float u, float v, const DistortionMeshes& meshes, float overfill_factor)
+{
+    // Flip v into RenderManager's convention and back, as in
+    // computeMeshDistortion().
+    float result[6];
+    std::size_t channels = 0;
+    for (const auto& mesh : meshes) {
+        mesh.interpolate(u, 1.0f - v, result + 2 * channels);
+        channels += mesh.getChannelCount();
+    }
+
+    if (1 == channels) {
+        // Achromatic: one channel for every color
+        result[2] = result[4] = result[0];
+        result[3] = result[5] = result[1];
+    }
+
+    if (1.0f != overfill_factor) {
+        for (auto& coordinate : result) {
+            coordinate = 0.5f + (coordinate - 0.5f) / overfill_factor;
+        }
+    }
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = result[0];
+    coords.rfRed[1] = 1.0f - result[1];
+    coords.rfGreen[0] = result[2];
+    coords.rfGreen[1] = 1.0f - result[3];
+    coords.rfBlue[0] = result[4];
+    coords.rfBlue[1] = 1.0f - result[5];
+    return coords;
+}
+
+DistortionMesh::CacheStatistics getCacheStatistics(const DistortionMeshes& meshes)
+{
+    DistortionMesh::CacheStatistics statistics = { 0, 0 };
+    for (const auto& mesh : meshes) {
+        const auto mesh_statistics = mesh.getCacheStatistics();
+        statistics.hits += mesh_statistics.hits;
+        statistics.misses += mesh_statistics.misses;
+    }
+    return statistics;
+}
@@ -0,0 +1,233 @@
+/** @file
+    @brief Triangulated distortion point samples with a spatial index.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionMesh_h_GUID_3F9C1A57_82E4_4B6D_A0D3_7E25C9B4F816
+#define INCLUDED_DistortionMesh_h_GUID_3F9C1A57_82E4_4B6D_A0D3_7E25C9B4F816
+
+// Internal Includes
+#include "Distortion.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+#include <osvr/RenderKit/DistortionParameters.h>
+#include <osvr/RenderKit/osvr_display_configuration.h>
+
+// Standard includes
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DistortionCacheReader;
+class DistortionCacheWriter;
+
+/**
+ * Distortion point samples, triangulated and indexed so the distortion at any
+ * point can be interpolated in close to constant time.
+ *
+ * The input points of the samples are Delaunay-triangulated and the output
+ * points are interpolated linearly across each triangle, so the mesh
+ * reproduces the samples exactly. A uniform grid over the input points lists
+ * the triangles overlapping each cell, so finding the triangle containing a
+ * point only takes a handful of tests. Points outside the mesh are
+ * extrapolated from the nearest triangle.
+ *
+ * A mesh can interpolate several channels (colors) sampled at the same input
+ * points at once: they share the triangle search and the barycentric
+ * coordinates, and only the final blend is done per channel.
+ *
+ * Queries usually come in raster order, so each thread remembers the last
+ * triangle it found in each mesh and first tries it and the few triangles
+ * between it and the new point before searching the grid.
+ *
+ * Coordinates follow RenderManager's convention: (0, 0) is the lower-left
+ * corner.
+ */
+class DistortionMesh {
+public:
+    /**
+     * How often the last-hit triangle cache found the triangle (a hit) or
+     * the grid had to be searched (a miss). The counters aren't
+     * synchronized, so they are approximate if several threads query the
+     * same mesh at once.
+     */
+    struct CacheStatistics {
+        std::uint64_t hits;
+        std::uint64_t misses;
+    };
+
+    /**
+     * Triangulates a set of (input, output) point samples. Samples with
+     * duplicate input points are dropped.
+     */
+    void build(const MonoPointDistortionMeshDescription& samples);
+
+    /**
+     * Triangulates several channels of point samples. They must all have the
+     * same input points in the same order; otherwise the mesh is left empty.
+     */
+    void build(const std::vector<const MonoPointDistortionMeshDescription*>& channels);
+
+    /**
+     * Returns @c true if the mesh hasn't been built or has no triangles.
+     */
+    bool empty() const;
+
+    std::size_t getTriangleCount() const;
+    std::size_t getChannelCount() const;
+
+    /**
+     * Returns the number of bytes the mesh has allocated.
+     */
+    std::size_t getMemoryUsage() const;
+
+    /**
+     * Returns the distorted coordinates of (u, v) for the first channel.
+     */
+    std::array<float, 2> interpolate(float u, float v) const;
+
+    /**
+     * Writes the distorted coordinates of (u, v) for every channel to
+     * @c result, two floats per channel.
+     */
+    void interpolate(float u, float v, float* result) const;
+
+    CacheStatistics getCacheStatistics() const;
+    void resetCacheStatistics();
+
+    /**
+     * Writes the built mesh to a distortion cache payload.
+     */
+    void save(DistortionCacheWriter& writer) const;
+
+    /**
+     * Replaces the mesh with one save() wrote. Returns @c false, leaving the
+     * mesh unchanged, if the payload doesn't hold a consistent mesh.
+     */
+    bool load(DistortionCacheReader& reader);
+
+private:
+    /**
+     * A triangle, stored in the form interpolation needs: the barycentric
+     * coordinates of p are (l1, l2) = inverse * (p - origin). For each
+     * channel, the interpolated value is then output + l1 * d1 + l2 * d2.
+     */
+    struct Triangle {
+        float origin[2];
+        float inverse[4]; // row-major 2x2
+    };
+
+    static const std::size_t ValuesPerChannel = 6; // output, d1, d2
+    static const std::uint32_t NoNeighbour = 0xffffffff;
+
+    /**
+     * A statistics counter that can be bumped from const queries and still
+     * lets the mesh be copied.
+     */
+    struct Counter {
+        Counter() = default;
+        Counter(const Counter& other);
+        Counter& operator=(const Counter& other);
+
+        void increment() const;
+
+        mutable std::atomic<std::uint64_t> value { 0 };
+    };
+
+    /**
+     * Returns the smallest barycentric coordinate of (u, v) in a triangle,
+     * which is non-negative if the triangle contains the point.
+     */
+    float getInsideScore(std::size_t index, float u, float v) const;
+
+    /**
+     * Returns the index of the triangle to interpolate (u, v) from, walking
+     * from this thread's last hit before falling back to searchTriangle().
+     */
+    std::size_t findTriangle(float u, float v) const;
+
+    /**
+     * Returns the index of the triangle to interpolate (u, v) from: one
+     * containing it if there is one, otherwise the closest one to it in the
+     * nearest non-empty grid cells.
+     */
+    std::size_t searchTriangle(float u, float v) const;
+
+    std::vector<Triangle> triangles_;
+    std::vector<std::array<std::uint32_t, 3>> neighbours_; // across from each vertex, NoNeighbour on the hull
+    std::vector<float> values_; // ValuesPerChannel floats per channel per triangle
+    std::size_t channels_ = 0;
+
+    // Uniform grid index over the bounding box of the input points. The
+    // triangles overlapping cell c are
+    // cellTriangles_[cellStart_[c]] ... cellTriangles_[cellStart_[c + 1] - 1].
+    float minU_ = 0.0f;
+    float minV_ = 0.0f;
+    float cellsPerU_ = 0.0f;
+    float cellsPerV_ = 0.0f;
+    std::size_t columns_ = 0;
+    std::size_t rows_ = 0;
+    std::vector<std::uint32_t> cellStart_;
+    std::vector<std::uint32_t> cellTriangles_;
+
+    Counter cacheHits_;
+    Counter cacheMisses_;
+};
+
+/**
+ * The distortion meshes of one eye, with three channels (red, green, blue)
+ * between them, or a single channel if the distortion is achromatic.
+ */
+using DistortionMeshes = std::vector<DistortionMesh>;
+
+/**
+ * Builds the distortion meshes for every eye, building up to @c threads of
+ * them at a time.
+ *
+ * @param parameters the distortion parameters for each eye, indexed by eye
+ * @return the meshes for each eye, empty for an eye whose parameters aren't
+ * point samples
+ */
+std::vector<DistortionMeshes> makeDistortionMeshes(const std::vector<osvr::renderkit::DistortionParameters>& parameters, std::size_t threads);
+
+/**
+ * Computes the distortion for all three colors from one eye's meshes.
+ *
+ * @param u, v texture coordinates with (0, 0) at the upper-left corner, already
+ * rotated to match the display
+ * @param overfill_factor how much larger than the display the render target
+ * is; the result is scaled about the center of the texture to match, as
+ * RenderManager's DistortionCorrectTextureCoordinate() does
+ */
+vr::DistortionCoordinates_t interpolateDistortion(float u, float v, const DistortionMeshes& meshes, float overfill_factor = 1.0f);
+
+/**
+ * Sums the triangle cache statistics of one eye's meshes.
+ */
+DistortionMesh::CacheStatistics getCacheStatistics(const DistortionMeshes& meshes);
+
+#endif // INCLUDED_DistortionMesh_h_GUID_3F9C1A57_82E4_4B6D_A0D3_7E25C9B4F816
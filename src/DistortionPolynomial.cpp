@@ -0,0 +1,436 @@
+/** @file
+    @brief Closed-form polynomial models fitted to the distortion.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionPolynomial.h"
+#include "DistortionCache.h"
+
+// Library/third-party includes
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+
+// Standard includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* const ColorNames[] = { "red", "green", "blue" };
+
+/**
+ * Returns a sample's distorted (u, v) for one color.
+ */
+const float* getColor(const DistortionSample& sample, std::size_t color)
+{
+    return (0 == color) ? sample.coords.rfRed : (1 == color) ? sample.coords.rfGreen : sample.coords.rfBlue;
+}
+
+std::size_t getTermCount(std::size_t degree)
+{
+    return (degree + 1) * (degree + 2) / 2;
+}
+
+/**
+ * Fills @c basis with the terms x^i y^j, i + j <= degree, in the order
+ * DistortionPolynomial stores their coefficients.
+ */
+void getPolynomialTerms(double x, double y, std::size_t degree, double* basis)
+{
+    double x_powers[DistortionPolynomial::MaxDegree + 1];
+    double y_powers[DistortionPolynomial::MaxDegree + 1];
+    x_powers[0] = 1.0;
+    y_powers[0] = 1.0;
+    for (std::size_t i = 1; i <= degree; ++i) {
+        x_powers[i] = x_powers[i - 1] * x;
+        y_powers[i] = y_powers[i - 1] * y;
+    }
+
+    for (std::size_t total = 0; total <= degree; ++total) {
+        for (std::size_t j = 0; j <= total; ++j) {
+            *basis++ = x_powers[total - j] * y_powers[j];
+        }
+    }
+}
+
+using Vector6d = Eigen::Matrix<double, 6, 1>;
+using Matrix6d = Eigen::Matrix<double, 6, 6>;
+
+/**
+ * The radial basis for u' (axis 0) or v' (axis 1): the unknowns are the two
+ * offsets and k0 ... k3.
+ */
+Vector6d getRadialBasis(double dx, double dy, std::size_t axis)
+{
+    const auto r2 = dx * dx + dy * dy;
+    const auto d = (0 == axis) ? dx : dy;
+    Vector6d basis;
+    basis << ((0 == axis) ? 1.0 : 0.0), ((0 == axis) ? 0.0 : 1.0), d, d * r2, d * r2 * r2, d * r2 * r2 * r2;
+    return basis;
+}
+
+/**
+ * Fits the radial model of one color about a given center and returns the
+ * sum of squared residuals, or infinity if the fit is singular.
+ */
+double fitRadialAbout(const std::vector<DistortionSample>& samples, std::size_t color, double cx, double cy, Vector6d& parameters)
+{
+    Matrix6d normal = Matrix6d::Zero();
+    Vector6d rhs = Vector6d::Zero();
+    for (const auto& sample : samples) {
+        const auto distorted = getColor(sample, color);
+        for (std::size_t axis = 0; axis < 2; ++axis) {
+            const auto basis = getRadialBasis(sample.u - cx, sample.v - cy, axis);
+            normal += basis * basis.transpose();
+            rhs += basis * static_cast<double>(distorted[axis]);
+        }
+    }
+
+    const auto ldlt = normal.ldlt();
+    if (ldlt.info() != Eigen::Success || ldlt.vectorD().minCoeff() <= 1e-12 * ldlt.vectorD().maxCoeff())
+        return std::numeric_limits<double>::infinity();
+    parameters = ldlt.solve(rhs);
+
+    double residual = 0.0;
+    for (const auto& sample : samples) {
+        const auto distorted = getColor(sample, color);
+        for (std::size_t axis = 0; axis < 2; ++axis) {
+            const auto error = getRadialBasis(sample.u - cx, sample.v - cy, axis).dot(parameters) - distorted[axis];
+            residual += error * error;
+        }
+    }
+    return residual;
+}
+
+} // anonymous namespace
+
+const std::size_t DistortionPolynomial::MaxDegree;
+
+std::vector<DistortionSample> sampleDistortion(const DistortionFunction& distortion, std::size_t grid)
+{
+    grid = std::max<std::size_t>(grid, 2);
+    std::vector<DistortionSample> samples;
+    samples.reserve(grid * grid);
+    for (std::size_t j = 0; j < grid; ++j) {
+        const auto v = static_cast<float>(j) / static_cast<float>(grid - 1);
+        for (std::size_t i = 0; i < grid; ++i) {
+            const auto u = static_cast<float>(i) / static_cast<float>(grid - 1);
+            samples.push_back({ u, v, distortion(u, v) });
+        }
+    }
+    return samples;
+}
+
+bool DistortionPolynomial::fitRadial(const std::vector<DistortionSample>& samples)
+{
+    model_ = Model::None;
+    degree_ = 0;
+    if (samples.size() < 6)
+        return false;
+
+    for (std::size_t color = 0; color < 3; ++color) {
+        // The model is only linear for a known center, so search for the
+        // center on successively finer grids, starting a little beyond the
+        // sampled area in case the lens is off-center.
+        auto best_residual = std::numeric_limits<double>::infinity();
+        auto best_x = 0.5;
+        auto best_y = 0.5;
+        Vector6d best_parameters = Vector6d::Zero();
+        auto step = 0.125;
+        auto first = true;
+        for (std::size_t level = 0; level < 5; ++level) {
+            const auto reach = first ? 6 : 2;
+            const auto around_x = best_x;
+            const auto around_y = best_y;
+            for (int j = -reach; j <= reach; ++j) {
+                for (int i = -reach; i <= reach; ++i) {
+                    const auto cx = around_x + i * step;
+                    const auto cy = around_y + j * step;
+                    Vector6d parameters;
+                    const auto residual = fitRadialAbout(samples, color, cx, cy, parameters);
+                    if (residual < best_residual) {
+                        best_residual = residual;
+                        best_x = cx;
+                        best_y = cy;
+                        best_parameters = parameters;
+                    }
+                }
+            }
+            first = false;
+            step *= 0.25;
+        }
+        if (best_residual == std::numeric_limits<double>::infinity())
+            return false;
+
+        auto& radial = radial_[color];
+        radial.center[0] = best_x;
+        radial.center[1] = best_y;
+        radial.offset[0] = best_parameters[0];
+        radial.offset[1] = best_parameters[1];
+        for (std::size_t k = 0; k < 4; ++k) {
+            radial.k[k] = best_parameters[k + 2];
+        }
+    }
+
+    model_ = Model::Radial;
+    return true;
+}
+
+bool DistortionPolynomial::fitPolynomial(const std::vector<DistortionSample>& samples, std::size_t degree)
+{
+    model_ = Model::None;
+    degree_ = 0;
+    const auto terms = getTermCount(degree);
+    if (degree > MaxDegree || samples.size() < terms)
+        return false;
+
+    // Every color and axis shares the same normal matrix.
+    Eigen::MatrixXd normal = Eigen::MatrixXd::Zero(terms, terms);
+    Eigen::MatrixXd rhs = Eigen::MatrixXd::Zero(terms, 6);
+    Eigen::VectorXd basis(terms);
+    for (const auto& sample : samples) {
+        getPolynomialTerms(2.0 * sample.u - 1.0, 2.0 * sample.v - 1.0, degree, basis.data());
+        normal += basis * basis.transpose();
+        for (std::size_t color = 0; color < 3; ++color) {
+            const auto distorted = getColor(sample, color);
+            rhs.col(2 * color) += basis * static_cast<double>(distorted[0]);
+            rhs.col(2 * color + 1) += basis * static_cast<double>(distorted[1]);
+        }
+    }
+
+    const auto ldlt = normal.ldlt();
+    if (ldlt.info() != Eigen::Success || ldlt.vectorD().minCoeff() <= 1e-12 * ldlt.vectorD().maxCoeff())
+        return false;
+    const Eigen::MatrixXd solution = ldlt.solve(rhs);
+
+    for (std::size_t color = 0; color < 3; ++color) {
+        auto& coefficients = coefficients_[color];
+        coefficients.resize(2 * terms);
+        for (std::size_t t = 0; t < terms; ++t) {
+            coefficients[t] = solution(t, 2 * color);
+            coefficients[terms + t] = solution(t, 2 * color + 1);
+        }
+    }
+
+    model_ = Model::Polynomial;
+    degree_ = degree;
+    return true;
+}
+
+bool DistortionPolynomial::empty() const
+{
+    return Model::None == model_;
+}
+
+DistortionPolynomial::Model DistortionPolynomial::getModel() const
+{
+    return model_;
+}
+
+std::size_t DistortionPolynomial::getDegree() const
+{
+    return degree_;
+}
+
+void DistortionPolynomial::evaluate(float u, float v, float* result) const
+{
+    if (Model::Radial == model_) {
+        for (const auto& radial : radial_) {
+            const auto dx = u - radial.center[0];
+            const auto dy = v - radial.center[1];
+            const auto r2 = dx * dx + dy * dy;
+            const auto scale = radial.k[0] + r2 * (radial.k[1] + r2 * (radial.k[2] + r2 * radial.k[3]));
+            *result++ = static_cast<float>(radial.offset[0] + dx * scale);
+            *result++ = static_cast<float>(radial.offset[1] + dy * scale);
+        }
+    } else if (Model::Polynomial == model_) {
+        const auto terms = getTermCount(degree_);
+        double basis[(MaxDegree + 1) * (MaxDegree + 2) / 2];
+        getPolynomialTerms(2.0 * u - 1.0, 2.0 * v - 1.0, degree_, basis);
+        for (const auto& coefficients : coefficients_) {
+            double distorted_u = 0.0;
+            double distorted_v = 0.0;
+            for (std::size_t t = 0; t < terms; ++t) {
+                distorted_u += coefficients[t] * basis[t];
+                distorted_v += coefficients[terms + t] * basis[t];
+            }
+            *result++ = static_cast<float>(distorted_u);
+            *result++ = static_cast<float>(distorted_v);
+        }
+    } else {
+        for (std::size_t color = 0; color < 3; ++color) {
+            *result++ = u;
+            *result++ = v;
+        }
+    }
+}
+
+vr::DistortionCoordinates_t DistortionPolynomial::evaluate(float u, float v) const
+{
+    float result[6];
+    evaluate(u, v, result);
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = result[0];
+    coords.rfRed[1] = result[1];
+    coords.rfGreen[0] = result[2];
+    coords.rfGreen[1] = result[3];
+    coords.rfBlue[0] = result[4];
+    coords.rfBlue[1] = result[5];
+    return coords;
+}
+
+void DistortionPolynomial::evaluate(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const
+{
+    float result[6];
+    for (std::size_t i = 0; i < count; ++i) {
+        evaluate(u[i], v[i], result);
+        out.red[0][i] = result[0];
+        out.red[1][i] = result[1];
+        out.green[0][i] = result[2];
+        out.green[1][i] = result[3];
+        out.blue[0][i] = result[4];
+        out.blue[1][i] = result[5];
+    }
+}
+
+double DistortionPolynomial::getMaxError(const DistortionFunction& reference, std::size_t grid) const
+{
+    return getMaxDistortionError([this](float u, float v) { return evaluate(u, v); }, reference, grid, grid);
+}
+
+void DistortionPolynomial::save(DistortionCacheWriter& writer) const
+{
+    writer.write(static_cast<std::uint32_t>(model_));
+    writer.write(static_cast<std::uint64_t>(degree_));
+    writer.write(radial_);
+    for (const auto& coefficients : coefficients_) {
+        writer.write(coefficients);
+    }
+}
+
+bool DistortionPolynomial::load(DistortionCacheReader& reader)
+{
+    DistortionPolynomial polynomial;
+    std::uint32_t model = 0;
+    std::uint64_t degree = 0;
+    if (!reader.read(model) || !reader.read(degree) || !reader.read(polynomial.radial_))
+        return false;
+    for (auto& coefficients : polynomial.coefficients_) {
+        if (!reader.read(coefficients))
+            return false;
+    }
+
+    if (static_cast<std::uint32_t>(Model::Radial) == model) {
+        polynomial.model_ = Model::Radial;
+    } else if (static_cast<std::uint32_t>(Model::Polynomial) == model && degree <= MaxDegree) {
+        // evaluate() reads two sets of coefficients per color.
+        const auto size = 2 * getTermCount(static_cast<std::size_t>(degree));
+        for (const auto& coefficients : polynomial.coefficients_) {
+            if (coefficients.size() != size)
+                return false;
+        }
+        polynomial.model_ = Model::Polynomial;
+        polynomial.degree_ = static_cast<std::size_t>(degree);
+    } else {
+        return false;
+    }
+
+    *this = std::move(polynomial);
+    return true;
+}
+
+std::ostream& operator<<(std::ostream& os, const DistortionPolynomial& polynomial)
+{
+    if (DistortionPolynomial::Model::Radial == polynomial.model_) {
+        os << "radial";
+        for (std::size_t color = 0; color < 3; ++color) {
+            const auto& radial = polynomial.radial_[color];
+            os << "; " << ColorNames[color] << ": center (" << radial.center[0] << ", " << radial.center[1] << "), offset ("
+               << radial.offset[0] << ", " << radial.offset[1] << "), k = [" << radial.k[0] << ", " << radial.k[1] << ", " << radial.k[2] << ", " << radial.k[3] << "]";
+        }
+    } else if (DistortionPolynomial::Model::Polynomial == polynomial.model_) {
+        os << "degree " << polynomial.degree_ << " polynomial";
+        for (std::size_t color = 0; color < 3; ++color) {
+            const auto& coefficients = polynomial.coefficients_[color];
+            const auto terms = coefficients.size() / 2;
+            for (std::size_t axis = 0; axis < 2; ++axis) {
+                os << "; " << ColorNames[color] << ((0 == axis) ? " u" : " v") << " = [";
+                for (std::size_t t = 0; t < terms; ++t) {
+                    os << ((0 == t) ? "" : ", ") << coefficients[axis * terms + t];
+                }
+                os << "]";
+            }
+        }
+    } else {
+        os << polynomial.model_;
+    }
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, DistortionPolynomial::Model model)
+{
+    switch (model) {
+    case DistortionPolynomial::Model::None:
+        os << "none";
+        break;
+    case DistortionPolynomial::Model::Radial:
+        os << "radial";
+        break;
+    case DistortionPolynomial::Model::Polynomial:
+        os << "polynomial";
+        break;
+    }
+    return os;
+}
+
+DistortionPolynomial fitDistortionPolynomial(const DistortionFunction& reference, double tolerance, std::size_t max_degree, double& error)
+{
+    // Fit to the grid nodes and validate between them.
+    const auto samples = sampleDistortion(reference, 33);
+    error = std::numeric_limits<double>::infinity();
+
+    DistortionPolynomial polynomial;
+    if (polynomial.fitRadial(samples)) {
+        error = polynomial.getMaxError(reference);
+        if (error <= tolerance)
+            return polynomial;
+    }
+
+    for (std::size_t degree = 2; degree <= std::min(max_degree, DistortionPolynomial::MaxDegree); ++degree) {
+        if (!polynomial.fitPolynomial(samples, degree))
+            continue;
+        const auto polynomial_error = polynomial.getMaxError(reference);
+        error = std::min(error, polynomial_error);
+        if (polynomial_error <= tolerance)
+            return polynomial;
+    }
+
+    return DistortionPolynomial();
+}
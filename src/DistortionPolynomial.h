@@ -0,0 +1,163 @@
+/** @file
+    @brief Closed-form polynomial models fitted to the distortion.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionPolynomial_h_GUID_7C3F0A25_91D8_4E6B_A5F2_0B84E6C19D37
+#define INCLUDED_DistortionPolynomial_h_GUID_7C3F0A25_91D8_4E6B_A5F2_0B84E6C19D37
+
+// Internal Includes
+#include "Distortion.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+class DistortionCacheReader;
+class DistortionCacheWriter;
+
+/**
+ * The distortion at one point, used to fit a model.
+ */
+struct DistortionSample {
+    float u;
+    float v;
+    vr::DistortionCoordinates_t coords;
+};
+
+/**
+ * Samples @c distortion at the nodes of a @c grid by @c grid grid over
+ * [0, 1] x [0, 1].
+ */
+std::vector<DistortionSample> sampleDistortion(const DistortionFunction& distortion, std::size_t grid);
+
+/**
+ * A closed-form model of the distortion of one eye, fitted by least squares
+ * to samples of a reference distortion function in SteamVR's texture
+ * coordinates, so it evaluates without any mesh search or rotation.
+ *
+ * Each color gets its own coefficients for one of two models:
+ *
+ * - radial: p' = o + (p - c) (k0 + k1 r^2 + k2 r^4 + k3 r^6), where
+ *   r = |p - c|, for lenses that are close to rotationally symmetric
+ * - polynomial: u' and v' are each a 2D polynomial in u and v of a given
+ *   total degree
+ */
+class DistortionPolynomial {
+public:
+    enum class Model {
+        None,
+        Radial,
+        Polynomial
+    };
+
+    /**
+     * The highest polynomial degree fitPolynomial() accepts.
+     */
+    static const std::size_t MaxDegree = 7;
+
+    /**
+     * Fits the radial model, searching for the center of each color. Returns
+     * @c false, leaving the model empty, if there are too few samples.
+     */
+    bool fitRadial(const std::vector<DistortionSample>& samples);
+
+    /**
+     * Fits 2D polynomials of total degree @c degree (at most MaxDegree).
+     * Returns @c false, leaving the model empty, if there are too few samples
+     * or the fit is singular.
+     */
+    bool fitPolynomial(const std::vector<DistortionSample>& samples, std::size_t degree);
+
+    bool empty() const;
+    Model getModel() const;
+    std::size_t getDegree() const;
+
+    vr::DistortionCoordinates_t evaluate(float u, float v) const;
+
+    /**
+     * Evaluates the distortion of the @c count points (u[i], v[i]).
+     */
+    void evaluate(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const;
+
+    /**
+     * Returns the largest distance between the model and @c reference for
+     * any color at the centers of a @c grid by @c grid grid of cells, which
+     * lie between the nodes sampleDistortion() fits to.
+     */
+    double getMaxError(const DistortionFunction& reference, std::size_t grid = 64) const;
+
+    /**
+     * Writes the fitted model to a distortion cache payload.
+     */
+    void save(DistortionCacheWriter& writer) const;
+
+    /**
+     * Replaces the model with one save() wrote. Returns @c false, leaving
+     * the model unchanged, if the payload doesn't hold a consistent model.
+     */
+    bool load(DistortionCacheReader& reader);
+
+    /**
+     * Writes the model and its coefficients, for the log.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const DistortionPolynomial& polynomial);
+
+private:
+    struct Radial {
+        double center[2];
+        double offset[2];
+        double k[4];
+    };
+
+    void evaluate(float u, float v, float* result) const;
+
+    Model model_ = Model::None;
+    std::size_t degree_ = 0;
+    std::array<Radial, 3> radial_; // red, green, blue
+
+    // For each color, the coefficients of u' and then of v', one per term
+    // x^i y^j with i + j <= degree_, in order of i + j and then of j, where
+    // x = 2u - 1 and y = 2v - 1.
+    std::array<std::vector<double>, 3> coefficients_;
+};
+
+std::ostream& operator<<(std::ostream& os, DistortionPolynomial::Model model);
+
+/**
+ * Fits the simplest model whose error on a validation grid is within
+ * @c tolerance: first radial, then polynomials of increasing degree up to
+ * @c max_degree.
+ *
+ * @param error set to the validation error of the returned model, or of the
+ * best model tried if none was within tolerance
+ * @return the model, or an empty one if none was within tolerance
+ */
+DistortionPolynomial fitDistortionPolynomial(const DistortionFunction& reference, double tolerance, std::size_t max_degree, double& error);
+
+#endif // INCLUDED_DistortionPolynomial_h_GUID_7C3F0A25_91D8_4E6B_A5F2_0B84E6C19D37
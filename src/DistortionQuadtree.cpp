@@ -0,0 +1,367 @@
+/** @file
+    @brief Adaptive quadtree of distortion samples with bounded error.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionQuadtree.h"
+#include "DistortionCache.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Sample = std::array<float, 6>;
+
+float clamp(float x)
+{
+    return std::max(0.0f, std::min(x, 1.0f));
+}
+
+/**
+ * Returns the largest distance between two samples for any color.
+ */
+float getSampleError(const Sample& a, const Sample& b)
+{
+    auto error = 0.0f;
+    for (std::size_t k = 0; k < 6; k += 2) {
+        const auto du = a[k] - b[k];
+        const auto dv = a[k + 1] - b[k + 1];
+        error = std::max(error, std::sqrt(du * du + dv * dv));
+    }
+    return error;
+}
+
+} // anonymous namespace
+
+const std::size_t DistortionQuadtree::MaxDepth;
+const std::size_t DistortionQuadtree::ValuesPerVertex;
+const std::uint32_t DistortionQuadtree::LeafFlag;
+
+void DistortionQuadtree::build(const DistortionBatchFunction& reference, float tolerance, std::size_t max_depth, std::size_t threads)
+{
+    nodes_.clear();
+    leafVertices_.clear();
+    offsets_.clear();
+    offsetUnit_ = 0.0f;
+    depth_ = 0;
+
+    // Cells are addressed on an integer grid as fine as the deepest level
+    // could be, so shared corners have the same key.
+    max_depth = std::min(max_depth, MaxDepth);
+    const auto resolution = std::uint32_t { 1 } << max_depth;
+    const auto key = [resolution](std::uint32_t x, std::uint32_t y) { return static_cast<std::uint64_t>(y) * (resolution + 1) + x; };
+    const auto to_coordinate = [resolution](std::uint32_t x) { return static_cast<float>(x) / static_cast<float>(resolution); };
+
+    // Every point is sampled once, in batches.
+    std::unordered_map<std::uint64_t, Sample> samples;
+    std::vector<std::uint64_t> pending;
+    const auto request = [&](std::uint32_t x, std::uint32_t y) {
+        const auto k = key(x, y);
+        if (samples.find(k) == samples.end()) {
+            pending.push_back(k);
+        }
+    };
+    const auto evaluate = [&]() {
+        std::sort(pending.begin(), pending.end());
+        pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+        const auto count = pending.size();
+        std::vector<float> us(count);
+        std::vector<float> vs(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            us[i] = to_coordinate(static_cast<std::uint32_t>(pending[i] % (resolution + 1)));
+            vs[i] = to_coordinate(static_cast<std::uint32_t>(pending[i] / (resolution + 1)));
+        }
+
+        std::vector<float> values(count * 6);
+        static const std::size_t BatchSize = 256;
+        parallelFor((count + BatchSize - 1) / BatchSize, threads, [&](std::size_t b) {
+            const auto begin = b * BatchSize;
+            const auto size = std::min(BatchSize, count - begin);
+            const DistortionBatch batch = { { &values[0 * count + begin], &values[1 * count + begin] }, { &values[2 * count + begin], &values[3 * count + begin] }, { &values[4 * count + begin], &values[5 * count + begin] } };
+            reference(&us[begin], &vs[begin], size, batch);
+        });
+
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& sample = samples[pending[i]];
+            for (std::size_t k = 0; k < 6; ++k) {
+                sample[k] = values[k * count + i];
+            }
+        }
+        pending.clear();
+    };
+    const auto sample = [&](std::uint32_t x, std::uint32_t y) -> const Sample& { return samples.find(key(x, y))->second; };
+
+    struct Cell {
+        std::uint32_t x;
+        std::uint32_t y;
+        std::uint32_t size;
+        std::uint32_t node;
+    };
+
+    nodes_.push_back(0);
+    std::vector<Cell> cells { { 0, 0, resolution, 0 } };
+    std::vector<Cell> leaves;
+    request(0, 0);
+    request(resolution, 0);
+    request(0, resolution);
+    request(resolution, resolution);
+
+    // Refine a level at a time so each level's samples form one batch.
+    for (std::size_t depth = 0; !cells.empty(); ++depth) {
+        depth_ = depth;
+        const auto can_split = (depth < max_depth);
+        if (can_split) {
+            for (const auto& cell : cells) {
+                const auto half = cell.size / 2;
+                request(cell.x + half, cell.y);
+                request(cell.x, cell.y + half);
+                request(cell.x + half, cell.y + half);
+                request(cell.x + cell.size, cell.y + half);
+                request(cell.x + half, cell.y + cell.size);
+            }
+        }
+        evaluate();
+
+        std::vector<Cell> next;
+        for (const auto& cell : cells) {
+            auto split = false;
+            if (can_split) {
+                // The test points are the corners the children would have.
+                const auto& a = sample(cell.x, cell.y);
+                const auto& b = sample(cell.x + cell.size, cell.y);
+                const auto& c = sample(cell.x, cell.y + cell.size);
+                const auto& d = sample(cell.x + cell.size, cell.y + cell.size);
+                const auto half = cell.size / 2;
+                const std::uint32_t tests[5][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 1, 2 } };
+                for (const auto& test : tests) {
+                    const auto fx = 0.5f * static_cast<float>(test[0]);
+                    const auto fy = 0.5f * static_cast<float>(test[1]);
+                    Sample interpolated;
+                    for (std::size_t k = 0; k < 6; ++k) {
+                        const auto upper = a[k] + (b[k] - a[k]) * fx;
+                        const auto lower = c[k] + (d[k] - c[k]) * fx;
+                        interpolated[k] = upper + (lower - upper) * fy;
+                    }
+                    if (getSampleError(interpolated, sample(cell.x + test[0] * half, cell.y + test[1] * half)) > tolerance) {
+                        split = true;
+                        break;
+                    }
+                }
+            }
+
+            if (split) {
+                const auto first = static_cast<std::uint32_t>(nodes_.size());
+                const auto half = cell.size / 2;
+                nodes_[cell.node] = first;
+                nodes_.resize(first + 4);
+                next.push_back({ cell.x, cell.y, half, first });
+                next.push_back({ cell.x + half, cell.y, half, first + 1 });
+                next.push_back({ cell.x, cell.y + half, half, first + 2 });
+                next.push_back({ cell.x + half, cell.y + half, half, first + 3 });
+            } else {
+                nodes_[cell.node] = LeafFlag | static_cast<std::uint32_t>(leaves.size());
+                leaves.push_back(cell);
+            }
+        }
+        cells.swap(next);
+    }
+
+    // Keep only the leaf corners, as offsets from the undistorted
+    // coordinates so they fit in 16 bits.
+    std::unordered_map<std::uint64_t, std::uint32_t> vertices;
+    std::vector<float> offsets;
+    auto max_offset = 0.0f;
+    leafVertices_.reserve(4 * leaves.size());
+    for (const auto& leaf : leaves) {
+        const std::uint32_t corners[4][2] = { { leaf.x, leaf.y }, { leaf.x + leaf.size, leaf.y }, { leaf.x, leaf.y + leaf.size }, { leaf.x + leaf.size, leaf.y + leaf.size } };
+        for (const auto& corner : corners) {
+            const auto k = key(corner[0], corner[1]);
+            const auto found = vertices.find(k);
+            if (found != vertices.end()) {
+                leafVertices_.push_back(found->second);
+                continue;
+            }
+
+            const auto index = static_cast<std::uint32_t>(vertices.size());
+            vertices[k] = index;
+            leafVertices_.push_back(index);
+
+            const auto& values = sample(corner[0], corner[1]);
+            const float undistorted[2] = { to_coordinate(corner[0]), to_coordinate(corner[1]) };
+            for (std::size_t i = 0; i < ValuesPerVertex; ++i) {
+                const auto offset = values[i] - undistorted[i % 2];
+                max_offset = std::max(max_offset, std::abs(offset));
+                offsets.push_back(offset);
+            }
+        }
+    }
+
+    const auto steps = static_cast<float>(std::numeric_limits<std::int16_t>::max());
+    offsetUnit_ = (max_offset > 0.0f) ? max_offset / steps : 1.0f;
+    offsets_.reserve(offsets.size());
+    for (const auto offset : offsets) {
+        offsets_.push_back(static_cast<std::int16_t>(std::lround(offset / offsetUnit_)));
+    }
+}
+
+bool DistortionQuadtree::empty() const
+{
+    return nodes_.empty();
+}
+
+std::size_t DistortionQuadtree::getLeafCount() const
+{
+    return leafVertices_.size() / 4;
+}
+
+std::size_t DistortionQuadtree::getVertexCount() const
+{
+    return offsets_.size() / ValuesPerVertex;
+}
+
+std::size_t DistortionQuadtree::getDepth() const
+{
+    return depth_;
+}
+
+std::size_t DistortionQuadtree::getMemoryUsage() const
+{
+    return nodes_.size() * sizeof(nodes_[0]) + leafVertices_.size() * sizeof(leafVertices_[0]) + offsets_.size() * sizeof(offsets_[0]);
+}
+
+void DistortionQuadtree::save(DistortionCacheWriter& writer) const
+{
+    writer.write(nodes_);
+    writer.write(leafVertices_);
+    writer.write(offsets_);
+    writer.write(offsetUnit_);
+    writer.write(static_cast<std::uint64_t>(depth_));
+}
+
+bool DistortionQuadtree::load(DistortionCacheReader& reader)
+{
+    DistortionQuadtree tree;
+    std::uint64_t depth = 0;
+    if (!reader.read(tree.nodes_) || !reader.read(tree.leafVertices_) || !reader.read(tree.offsets_) || !reader.read(tree.offsetUnit_) || !reader.read(depth))
+        return false;
+
+    // The checksum has already ruled out corruption, so only check that the
+    // arrays fit together well enough for lookups to stay in bounds.
+    if (tree.nodes_.empty() || depth > MaxDepth || tree.leafVertices_.size() % 4 != 0 || tree.offsets_.size() % ValuesPerVertex != 0)
+        return false;
+    const auto leaves = tree.getLeafCount();
+    const auto vertices = tree.getVertexCount();
+    for (const auto node : tree.nodes_) {
+        const auto in_bounds = (node & LeafFlag) ? (node & ~LeafFlag) < leaves : node + 4 <= tree.nodes_.size();
+        if (!in_bounds)
+            return false;
+    }
+    if (!std::all_of(tree.leafVertices_.begin(), tree.leafVertices_.end(), [vertices](std::uint32_t vertex) { return vertex < vertices; }))
+        return false;
+
+    tree.depth_ = static_cast<std::size_t>(depth);
+    *this = std::move(tree);
+    return true;
+}
+
+void DistortionQuadtree::interpolate(float u, float v, float* result) const
+{
+    u = clamp(u);
+    v = clamp(v);
+
+    // Descend to the leaf, at most depth_ steps.
+    auto x = 0.0f;
+    auto y = 0.0f;
+    auto size = 1.0f;
+    auto node = nodes_[0];
+    while (!(node & LeafFlag)) {
+        size *= 0.5f;
+        const auto right = (u >= x + size);
+        const auto below = (v >= y + size);
+        x += right ? size : 0.0f;
+        y += below ? size : 0.0f;
+        node = nodes_[node + (right ? 1 : 0) + (below ? 2 : 0)];
+    }
+
+    const auto fx = (u - x) / size;
+    const auto fy = (v - y) / size;
+    const auto corners = &leafVertices_[(node & ~LeafFlag) * 4];
+    const auto a = &offsets_[corners[0] * ValuesPerVertex];
+    const auto b = &offsets_[corners[1] * ValuesPerVertex];
+    const auto c = &offsets_[corners[2] * ValuesPerVertex];
+    const auto d = &offsets_[corners[3] * ValuesPerVertex];
+    for (std::size_t k = 0; k < ValuesPerVertex; ++k) {
+        const auto upper = a[k] + (b[k] - a[k]) * fx;
+        const auto lower = c[k] + (d[k] - c[k]) * fx;
+        result[k] = (upper + (lower - upper) * fy) * offsetUnit_ + ((k % 2) ? v : u);
+    }
+}
+
+vr::DistortionCoordinates_t DistortionQuadtree::lookup(float u, float v) const
+{
+    float result[ValuesPerVertex];
+    interpolate(u, v, result);
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = result[0];
+    coords.rfRed[1] = result[1];
+    coords.rfGreen[0] = result[2];
+    coords.rfGreen[1] = result[3];
+    coords.rfBlue[0] = result[4];
+    coords.rfBlue[1] = result[5];
+    return coords;
+}
+
+void DistortionQuadtree::lookup(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const
+{
+    float result[ValuesPerVertex];
+    for (std::size_t i = 0; i < count; ++i) {
+        interpolate(u[i], v[i], result);
+        out.red[0][i] = result[0];
+        out.red[1][i] = result[1];
+        out.green[0][i] = result[2];
+        out.green[1][i] = result[3];
+        out.blue[0][i] = result[4];
+        out.blue[1][i] = result[5];
+    }
+}
+
+double DistortionQuadtree::getMaxError(const DistortionFunction& reference) const
+{
+    const auto cells = std::min<std::size_t>(std::size_t { 2 } << depth_, 256);
+    return getMaxDistortionError([this](float u, float v) { return lookup(u, v); }, reference, cells, cells);
+}
@@ -0,0 +1,139 @@
+/** @file
+    @brief Adaptive quadtree of distortion samples with bounded error.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionQuadtree_h_GUID_A41D7C93_2F6E_4B85_B3C0_9E57D12A8F46
+#define INCLUDED_DistortionQuadtree_h_GUID_A41D7C93_2F6E_4B85_B3C0_9E57D12A8F46
+
+// Internal Includes
+#include "Distortion.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DistortionCacheReader;
+class DistortionCacheWriter;
+
+/**
+ * A distortion function sampled over [0, 1] x [0, 1] on an adaptive
+ * quadtree and reconstructed by bilinear interpolation within each leaf.
+ *
+ * Cells are only split where bilinear interpolation across them is further
+ * than a tolerance from the reference function, so the nearly linear center
+ * of a lens gets a few large cells and the edges get small ones. The corner
+ * samples are shared between leaves and stored as 16-bit fixed-point offsets
+ * from the undistorted coordinates.
+ *
+ * A lookup descends at most the maximum depth the tree was built with.
+ */
+class DistortionQuadtree {
+public:
+    /**
+     * The deepest tree that can be built: 2^15 cells on a side.
+     */
+    static const std::size_t MaxDepth = 15;
+
+    /**
+     * Builds the tree from a reference distortion function.
+     *
+     * A cell is split if interpolating across it is further than
+     * @c tolerance from @c reference (for any color) at its center or the
+     * middle of any of its edges, unless it is already @c max_depth levels
+     * deep.
+     *
+     * @c reference is called with batches of points. With more than one
+     * thread, the batches are split between them, so it must be safe to call
+     * concurrently.
+     */
+    void build(const DistortionBatchFunction& reference, float tolerance, std::size_t max_depth, std::size_t threads = 1);
+
+    /**
+     * Returns @c true if the tree hasn't been built.
+     */
+    bool empty() const;
+
+    std::size_t getLeafCount() const;
+    std::size_t getVertexCount() const;
+    std::size_t getDepth() const;
+
+    /**
+     * Returns the number of bytes the tree's data takes up.
+     */
+    std::size_t getMemoryUsage() const;
+
+    /**
+     * Looks up the distortion at (u, v). Coordinates outside [0, 1] are
+     * clamped.
+     */
+    vr::DistortionCoordinates_t lookup(float u, float v) const;
+
+    /**
+     * Looks up the distortion of the @c count points (u[i], v[i]).
+     */
+    void lookup(const float* u, const float* v, std::size_t count, const DistortionBatch& out) const;
+
+    /**
+     * Returns the largest distance between the tree and @c reference for
+     * any color, measured on a grid twice as fine as the deepest leaves (up
+     * to 256 by 256).
+     */
+    double getMaxError(const DistortionFunction& reference) const;
+
+    /**
+     * Writes the built tree to a distortion cache payload.
+     */
+    void save(DistortionCacheWriter& writer) const;
+
+    /**
+     * Replaces the tree with one save() wrote. Returns @c false, leaving the
+     * tree unchanged, if the payload doesn't hold a consistent tree.
+     */
+    bool load(DistortionCacheReader& reader);
+
+private:
+    static const std::size_t ValuesPerVertex = 6; // (u, v) for red, green, blue
+
+    // A node is either a leaf, flagged with LeafFlag and holding its leaf
+    // number, or the index of the first of its four children in nodes_
+    // (lower u and lower v first, u varying fastest).
+    static const std::uint32_t LeafFlag = 0x80000000;
+
+    /**
+     * Interpolates the leaf containing (u, v) into @c result.
+     */
+    void interpolate(float u, float v, float* result) const;
+
+    std::vector<std::uint32_t> nodes_;
+    std::vector<std::uint32_t> leafVertices_; // four corners per leaf, in child order
+    std::vector<std::int16_t> offsets_; // ValuesPerVertex per vertex, distorted minus undistorted
+    float offsetUnit_ = 0.0f; // texture coordinate units per offset step
+    std::size_t depth_ = 0;
+};
+
+#endif // INCLUDED_DistortionQuadtree_h_GUID_A41D7C93_2F6E_4B85_B3C0_9E57D12A8F46
@@ -0,0 +1,168 @@
+/** @file
+    @brief Estimates velocity and acceleration from recent poses.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "MotionEstimator.h"
+
+// Library/third-party includes
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValue.h>
+
+// Standard includes
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+/**
+ * Returns the rotation vector (axis times angle) of a unit quaternion, taking
+ * the shorter way around.
+ */
+Eigen::Vector3d toRotationVector(Eigen::Quaterniond q)
+{
+    if (q.w() < 0.0) {
+        q.coeffs() = -q.coeffs();
+    }
+
+    const auto sin_half_angle = q.vec().norm();
+    if (sin_half_angle < 1e-12) {
+        // Small-angle approximation
+        return 2.0 * q.vec();
+    }
+
+    const auto angle = 2.0 * std::atan2(sin_half_angle, q.w());
+    return q.vec() * (angle / sin_half_angle);
+}
+
+} // anonymous namespace
+
+const std::size_t MotionEstimator::WindowSize;
+
+void MotionEstimator::setMaxGap(double max_gap)
+{
+    maxGap_ = max_gap;
+}
+
+void MotionEstimator::addSample(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation)
+{
+    PoseSample sample;
+    sample.timestamp = timestamp;
+    sample.position = position;
+    sample.orientation = orientation.normalized();
+
+    if (!samples_.empty()) {
+        const auto dt = osvr::util::time::duration(timestamp, samples_.back().timestamp);
+        if (dt < 0.0) {
+            // Out of order
+            return;
+        } else if (dt == 0.0) {
+            samples_.back() = sample;
+            update();
+            return;
+        } else if (dt > maxGap_) {
+            // The device stopped reporting for a while. Don't difference
+            // across the gap.
+            samples_.clear();
+        }
+    }
+
+    samples_.push_back(sample);
+    update();
+}
+
+const MotionEstimator::Estimate& MotionEstimator::getEstimate() const
+{
+    return estimate_;
+}
+
+void MotionEstimator::reset()
+{
+    samples_.clear();
+    estimate_ = Estimate();
+}
+
+void MotionEstimator::update()
+{
+    estimate_ = Estimate();
+
+    const auto n = samples_.size();
+    if (n < 2)
+        return;
+
+    const auto& newest = samples_.back();
+    const Eigen::Quaterniond newest_inverse = Eigen::Quaterniond(newest.orientation).conjugate();
+
+    // Scale time by the span of the window to keep the normal equations well
+    // conditioned. Times run from -1 (oldest) to 0 (newest).
+    const auto span = osvr::util::time::duration(newest.timestamp, samples_.front().timestamp);
+    if (span <= 0.0)
+        return;
+
+    // Accumulate the normal equations for y(s) = c0 + c1 s + c2 s^2, where y
+    // holds the position and rotation vector relative to the newest sample.
+    using Vector6d = Eigen::Matrix<double, 6, 1>;
+    Eigen::Matrix3d normal = Eigen::Matrix3d::Zero();
+    Eigen::Matrix<double, 3, 6> rhs = Eigen::Matrix<double, 3, 6>::Zero();
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto& sample = samples_[i];
+        const auto s = osvr::util::time::duration(sample.timestamp, newest.timestamp) / span;
+        const Eigen::Vector3d basis(1.0, s, s * s);
+
+        Vector6d y;
+        y.head<3>() = sample.position - newest.position;
+        y.tail<3>() = toRotationVector(newest_inverse * Eigen::Quaterniond(sample.orientation));
+
+        normal += basis * basis.transpose();
+        rhs += basis * y.transpose();
+    }
+
+    Vector6d velocity;
+    Vector6d acceleration = Vector6d::Zero();
+
+    // Three samples are enough for a quadratic, but make sure they aren't so
+    // bunched up in time that the fit is meaningless.
+    const auto quadratic = normal.ldlt();
+    const auto min_pivot = quadratic.vectorD().minCoeff();
+    if (n >= 3 && quadratic.info() == Eigen::Success && min_pivot > 1e-6 * n) {
+        const Eigen::Matrix<double, 3, 6> coeffs = quadratic.solve(rhs);
+        velocity = coeffs.row(1).transpose() / span;
+        acceleration = 2.0 * coeffs.row(2).transpose() / (span * span);
+        estimate_.hasAcceleration = true;
+    } else {
+        // Fall back to a straight line.
+        const Eigen::Matrix2d linear_normal = normal.topLeftCorner<2, 2>();
+        const Eigen::Matrix<double, 2, 6> coeffs = linear_normal.ldlt().solve(rhs.topRows<2>());
+        velocity = coeffs.row(1).transpose() / span;
+    }
+
+    estimate_.velocity = velocity.head<3>();
+    estimate_.angularVelocity = velocity.tail<3>();
+    estimate_.acceleration = acceleration.head<3>();
+    estimate_.angularAcceleration = acceleration.tail<3>();
+    estimate_.valid = true;
+}
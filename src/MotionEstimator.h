@@ -0,0 +1,99 @@
+/** @file
+    @brief Estimates velocity and acceleration from recent poses.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_MotionEstimator_h_GUID_A2D64F18_7C3B_4E95_B1F0_5E8D29C7A4B6
+#define INCLUDED_MotionEstimator_h_GUID_A2D64F18_7C3B_4E95_B1F0_5E8D29C7A4B6
+
+// Internal Includes
+#include "PoseSample.h"
+#include "RingBuffer.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <cstddef>
+
+/**
+ * Estimates linear and angular velocity and acceleration from the most recent
+ * poses of a tracked device.
+ *
+ * Each component of the position and of the orientation (as a rotation vector
+ * relative to the newest pose) is fit with a quadratic by least squares over
+ * a fixed window of samples, so the cost per sample is constant and nothing
+ * is allocated. Angular quantities are expressed in the frame of the newest
+ * pose, like the angular velocity we report to SteamVR.
+ */
+class MotionEstimator {
+public:
+    /**
+     * Number of samples the estimate is computed over.
+     */
+    static const std::size_t WindowSize = 8;
+
+    struct Estimate {
+        Eigen::Vector3d velocity = Eigen::Vector3d::Zero();                 ///< m/s
+        Eigen::Vector3d acceleration = Eigen::Vector3d::Zero();             ///< m/s^2
+        Eigen::Vector3d angularVelocity = Eigen::Vector3d::Zero();          ///< rad/s
+        Eigen::Vector3d angularAcceleration = Eigen::Vector3d::Zero();      ///< rad/s^2
+        bool valid = false;                                                 ///< velocities are available
+        bool hasAcceleration = false;                                       ///< accelerations are available
+    };
+
+    /**
+     * Sets the longest gap between samples, in seconds, before the history is
+     * discarded as stale.
+     */
+    void setMaxGap(double max_gap);
+
+    /**
+     * Adds a pose and updates the estimate. Samples which are not newer than
+     * the last one are ignored, except that a sample with the same timestamp
+     * replaces it.
+     */
+    void addSample(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation);
+
+    /**
+     * Returns the estimate as of the newest sample.
+     */
+    const Estimate& getEstimate() const;
+
+    /**
+     * Discards the history and the estimate.
+     */
+    void reset();
+
+private:
+    void update();
+
+    RingBuffer<PoseSample, WindowSize> samples_;
+    Estimate estimate_;
+    double maxGap_ = 0.1;
+};
+
+#endif // INCLUDED_MotionEstimator_h_GUID_A2D64F18_7C3B_4E95_B1F0_5E8D29C7A4B6
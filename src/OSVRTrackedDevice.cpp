@@ -40,20 +40,23 @@
 #include <osvr/ClientKit/Display.h>
 #include <osvr/Display/DisplayEnumerator.h>
 #include <osvr/Util/EigenInterop.h>
+#include <osvr/Util/TimeValue.h>
 #include <osvr/Client/RenderManagerConfig.h>
 #include <util/FixedLengthStringFunctions.h>
 #include <osvr/RenderKit/DistortionCorrectTextureCoordinate.h>
 
 // Standard includes
+#include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <string>
 #include <iostream>
 #include <exception>
 #include <fstream>
+#include <sstream>
 #include <algorithm>        // for std::find
 
-OSVRTrackedDevice::OSVRTrackedDevice(osvr::clientkit::ClientContext& context, vr::ETrackedDeviceClass device_class, const std::string& name) : context_(context), deviceClass_(device_class), name_(name), pose_()
+OSVRTrackedDevice::OSVRTrackedDevice(osvr::clientkit::ClientContext& context, vr::ETrackedDeviceClass device_class, const std::string& name) : context_(context), deviceClass_(device_class), name_(name)
 {
     OSVR_LOG(trace) << "OSVRTrackedDevice::OSVRTrackedDevice() called.";
 }
@@ -118,16 +121,46 @@ void OSVRTrackedDevice::DebugRequest(const char* request, char* response_buffer,
     // Log the requests just to see what info clients are looking for
     OSVR_LOG(debug) << name_ << ": Received debug request [" << request << "] with response buffer size of " << response_buffer_size << "].";
 
+    if (0 == response_buffer_size)
+        return;
+
     // make use of (from vrtypes.h) static const uint32_t k_unMaxDriverDebugResponseSize = 32768;
-    // return empty string for now
-    if (response_buffer_size > 0) {
-        response_buffer[0] = '\0';
+    std::string response;
+    double milliseconds = 0.0;
+    if (1 == std::sscanf(request, "pose_at %lf", &milliseconds)) {
+        const auto microseconds = static_cast<std::int64_t>(milliseconds * 1000.0);
+        auto time = osvr::util::time::getNow();
+        time.seconds -= microseconds / 1000000;
+        time.microseconds -= static_cast<OSVR_TimeValue_Microseconds>(microseconds % 1000000);
+        osvrTimeValueNormalize(&time);
+
+        const auto pose = getPoseAt(time);
+        std::ostringstream json;
+        json << "{\"valid\": " << (pose.poseIsValid ? "true" : "false")
+             << ", \"position\": [" << pose.vecPosition[0] << ", " << pose.vecPosition[1] << ", " << pose.vecPosition[2] << "]"
+             << ", \"orientation\": [" << pose.qRotation.w << ", " << pose.qRotation.x << ", " << pose.qRotation.y << ", " << pose.qRotation.z << "]"
+             << ", \"poseTimeOffset\": " << pose.poseTimeOffset << "}";
+        response = json.str();
     }
+
+    // Truncate the response if it doesn't fit
+    const auto length = std::min<std::size_t>(response.size(), response_buffer_size - 1);
+    response.copy(response_buffer, length);
+    response_buffer[length] = '\0';
 }
 
 vr::DriverPose_t OSVRTrackedDevice::GetPose()
 {
-    return pose_;
+    const auto sample = pose_.load();
+    if (!predictor_.enabled())
+        return sample.pose;
+
+    // Predict from the time of the report rather than from when it was
+    // published.
+    const auto age = osvr::util::time::duration(osvr::util::time::getNow(), sample.timestamp);
+    auto pose = sample.pose;
+    pose.poseTimeOffset = age;
+    return predictor_.predict(pose, age + predictor_.getTargetOffset());
 }
 
 const char* OSVRTrackedDevice::getId()
@@ -145,7 +178,112 @@ std::string OSVRTrackedDevice::getName() const
     return name_;
 }
 
+std::uint64_t OSVRTrackedDevice::getReportCount() const
+{
+    return reportCount_.load(std::memory_order_relaxed);
+}
+
+void OSVRTrackedDevice::setCoalescePoses(bool coalesce)
+{
+    coalescePoses_ = coalesce;
+}
+
+void OSVRTrackedDevice::flushPose()
+{
+    if (!hasStagedPose_)
+        return;
+
+    // The pose has aged since it was staged, so bring its time offset up to
+    // date before predicting from it.
+    hasStagedPose_ = false;
+    stagedPose_.poseTimeOffset = osvr::util::time::duration(osvr::util::time::getNow(), stagedTimestamp_);
+    sendPose(stagedPose_);
+}
+
+std::uint64_t OSVRTrackedDevice::getCoalescedCount() const
+{
+    return coalescedCount_.load(std::memory_order_relaxed);
+}
+
+vr::DriverPose_t OSVRTrackedDevice::getPoseAt(const OSVR_TimeValue& time) const
+{
+    // Start from the latest pose for everything but position and orientation
+    auto pose = pose_.load().pose;
+
+    PoseSample sample;
+    if (!poseHistory_.getPoseAt(time, sample)) {
+        pose.poseIsValid = false;
+        return pose;
+    }
+
+    Eigen::Vector3d::Map(pose.vecPosition) = sample.position;
+    map(pose.qRotation) = Eigen::Quaterniond(sample.orientation);
+    pose.poseTimeOffset = osvr::util::time::duration(osvr::util::time::getNow(), time);
+    return pose;
+}
+
 // ------------------------------------
 // Protected Methods
 // ------------------------------------
 
+void OSVRTrackedDevice::publishPose(const vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp)
+{
+    pose_.store({ pose, timestamp });
+
+    if (pose.poseIsValid) {
+        PoseSample sample;
+        sample.timestamp = timestamp;
+        sample.position = Eigen::Vector3d::Map(pose.vecPosition);
+        sample.orientation = Eigen::Quaterniond(map(pose.qRotation));
+        poseHistory_.insert(sample, Eigen::Vector3d::Map(pose.vecVelocity), Eigen::Vector3d::Map(pose.vecAngularVelocity));
+    }
+
+    if (coalescePoses_) {
+        if (hasStagedPose_) {
+            coalescedCount_.fetch_add(1, std::memory_order_relaxed);
+        }
+        stagedPose_ = pose;
+        stagedTimestamp_ = timestamp;
+        hasStagedPose_ = true;
+        return;
+    }
+
+    sendPose(pose);
+}
+
+void OSVRTrackedDevice::estimateMotion(vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp, bool has_velocity, bool has_angular_velocity)
+{
+    if (!estimateMotion_ || !pose.poseIsValid)
+        return;
+
+    motionEstimator_.addSample(timestamp, Eigen::Vector3d::Map(pose.vecPosition), map(pose.qRotation));
+    const auto& estimate = motionEstimator_.getEstimate();
+    if (!estimate.valid)
+        return;
+
+    if (!has_velocity) {
+        Eigen::Vector3d::Map(pose.vecVelocity) = estimate.velocity;
+    }
+
+    if (!has_angular_velocity) {
+        Eigen::Vector3d::Map(pose.vecAngularVelocity) = estimate.angularVelocity;
+    }
+
+    Eigen::Vector3d::Map(pose.vecAcceleration) = estimate.acceleration;
+    Eigen::Vector3d::Map(pose.vecAngularAcceleration) = estimate.angularAcceleration;
+}
+
+// ------------------------------------
+// Private Methods
+// ------------------------------------
+
+void OSVRTrackedDevice::sendPose(const vr::DriverPose_t& pose)
+{
+    if (!predictor_.enabled()) {
+        vr::VRServerDriverHost()->TrackedDevicePoseUpdated(objectId_, pose, sizeof(vr::DriverPose_t));
+        return;
+    }
+
+    const auto predicted = predictor_.predict(pose, pose.poseTimeOffset + predictor_.getTargetOffset());
+    vr::VRServerDriverHost()->TrackedDevicePoseUpdated(objectId_, predicted, sizeof(vr::DriverPose_t));
+}
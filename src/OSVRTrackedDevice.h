@@ -27,6 +27,10 @@
 #define INCLUDED_OSVRTrackedDevice_h_GUID_B9C023D1_81C6_4FC7_B994_1614E86C861C
 
 // Internal Includes
+#include "MotionEstimator.h"
+#include "PoseHistory.h"
+#include "PosePredictor.h"
+#include "SeqLock.h"
 #include "Settings.h"
 #include "osvr_compiler_detection.h"
 
@@ -34,8 +38,11 @@
 #include <openvr_driver.h>
 
 #include <osvr/ClientKit/Context.h>
+#include <osvr/Util/TimeValueC.h>
 
 // Standard includes
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <memory>
 
@@ -81,6 +88,10 @@ public:
      * requests is entirely up to the driver and the client to figure out, as is
      * the format of the response. Responses that exceed the length of the
      * supplied buffer should be truncated and null terminated.
+     *
+     * Supported requests:
+     * - @c "pose_at <ms>" returns the pose of the device @c ms milliseconds
+     *   ago (negative values look ahead) from the pose history, as JSON.
      */
     virtual void DebugRequest(const char* request, char* response_buffer, uint32_t response_buffer_size) OSVR_OVERRIDE;
     //@}
@@ -95,22 +106,96 @@ public:
     const char* getId();
     vr::ETrackedDeviceClass getDeviceClass() const;
     std::string getName() const;
+
+    /**
+     * Returns the number of tracker reports this device has received.
+     */
+    std::uint64_t getReportCount() const;
+
+    /**
+     * Returns the pose of this device at @c time, interpolated between or
+     * extrapolated from recent poses. The pose is marked invalid if @c time
+     * is outside the pose history.
+     */
+    vr::DriverPose_t getPoseAt(const OSVR_TimeValue& time) const;
+
+    /**
+     * When enabled, poses aren't reported to vrserver as they arrive but
+     * held until flushPose() is called, so only the newest of several
+     * reports dispatched by one update() is sent.
+     */
+    void setCoalescePoses(bool coalesce);
+
+    /**
+     * Reports the newest held pose, if any, to vrserver. Must be called on
+     * the client update thread.
+     */
+    void flushPose();
+
+    /**
+     * Returns the number of reports which were superseded before being sent
+     * to vrserver.
+     */
+    std::uint64_t getCoalescedCount() const;
     //@}
 
 protected:
     void setSerialNumber(const std::string& serial_number);
 
+    /**
+     * Stores a new pose for GetPose() and reports it to vrserver, predicted
+     * forward if prediction is enabled, either now or at the next flushPose()
+     * when coalescing. Called from the tracker callbacks on the client update
+     * thread.
+     *
+     * @param pose the pose as reported, with poseTimeOffset set to its age
+     * @param timestamp the time of the report
+     */
+    void publishPose(const vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp);
+
+    /**
+     * Adds a pose to the motion history and fills in its accelerations, and
+     * any velocities the tracker didn't report, from the motion estimate.
+     * Does nothing unless motion estimation is enabled.
+     */
+    void estimateMotion(vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp, bool has_velocity, bool has_angular_velocity);
+
     osvr::clientkit::ClientContext& context_;
     vr::ETrackedDeviceClass deviceClass_ = vr::TrackedDeviceClass_Invalid;
     std::string name_;
-    vr::DriverPose_t pose_;
+    PosePredictor predictor_;
+    MotionEstimator motionEstimator_;
+    bool estimateMotion_ = false;
     uint32_t objectId_ = vr::k_unTrackedDeviceIndexInvalid;
     std::string serialNumber_;
     std::unique_ptr<Settings> settings_;
     vr::PropertyContainerHandle_t propertyContainer_ = vr::k_ulInvalidPropertyContainer;
+    std::atomic<std::uint64_t> reportCount_ { 0 };
 
 private:
+    /**
+     * The last pose received, before prediction.
+     */
+    struct StampedPose {
+        vr::DriverPose_t pose;
+        OSVR_TimeValue timestamp;
+    };
+
+    /**
+     * Sends a pose to vrserver, predicting it forward if enabled.
+     */
+    void sendPose(const vr::DriverPose_t& pose);
+
+    SeqLock<StampedPose> pose_;
+    PoseHistory poseHistory_;
+
+    // Only touched by the client update thread
+    bool coalescePoses_ = false;
+    bool hasStagedPose_ = false;
+    vr::DriverPose_t stagedPose_;
+    OSVR_TimeValue stagedTimestamp_;
 
+    std::atomic<std::uint64_t> coalescedCount_ { 0 };
 };
 
 inline void OSVRTrackedDevice::setSerialNumber(const std::string& serial_number)
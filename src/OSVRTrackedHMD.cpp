@@ -24,7 +24,12 @@
 
 // Internal Includes
 #include "OSVRTrackedHMD.h"
+#include "Distortion.h"
+#include "DistortionCache.h"
+#include "DistortionKernel.h"
+#include "DistortionMesh.h"
 #include "Logging.h"
+#include "ProcessMemory.h"
 
 #include "osvr_compiler_detection.h"
 #include "make_unique.h"
@@ -33,6 +38,7 @@
 #include "platform_fixes.h" // strcasecmp
 #include "make_unique.h"
 #include "OSVRDisplay.h"
+#include "Version.h"                // for STEAMVR_OSVR_VERSION
 
 // OpenVR includes
 #include <openvr_driver.h>
@@ -44,20 +50,26 @@
 #include <osvr/Util/PlatformConfig.h>
 #include <osvr/Client/RenderManagerConfig.h>
 #include <util/FixedLengthStringFunctions.h>
-#include <osvr/RenderKit/DistortionCorrectTextureCoordinate.h>
-#include <osvr/ClientKit/InterfaceStateC.h>
 #include <osvr/Util/EigenQuatExponentialMap.h>
 #include <osvr/Util/TimeValue.h>
 
 // Standard includes
 #include <algorithm>        // for std::find
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
 #include <exception>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
-#include <tuple>
+#include <utility>
+#include <vector>
 
 OSVRTrackedHMD::OSVRTrackedHMD(osvr::clientkit::ClientContext& context) : OSVRTrackedDevice(context, vr::TrackedDeviceClass_HMD, "OSVRTrackedHMD")
 {
@@ -66,7 +78,8 @@ OSVRTrackedHMD::OSVRTrackedHMD(osvr::clientkit::ClientContext& context) : OSVRTr
 
 OSVRTrackedHMD::~OSVRTrackedHMD()
 {
-    // do nothing
+    // The distortion build refers to our members.
+    finishDistortionBuild();
 }
 
 vr::EVRInitError OSVRTrackedHMD::Activate(uint32_t object_id)
@@ -81,6 +94,9 @@ vr::EVRInitError OSVRTrackedHMD::Activate(uint32_t object_id)
     if (trackerInterface_.notEmpty()) {
         trackerInterface_.free();
     }
+    if (positionInterface_.notEmpty()) {
+        positionInterface_.free();
+    }
 
     // Ensure context is fully started up
     OSVR_LOG(trace) << "OSVRTrackedHMD::Activate(): Waiting for the context to fully start up...\n";
@@ -142,9 +158,25 @@ vr::EVRInitError OSVRTrackedHMD::Activate(uint32_t object_id)
     configureDistortionParameters();
     setProperties();
 
-    // Register tracker callback
-    trackerInterface_ = context_.getInterface("/me/head");
-    trackerInterface_.registerCallback(&OSVRTrackedHMD::HmdTrackerCallback, this);
+    // Register tracker callbacks
+    if (splitOrientationAndPosition_ && (positionPath_.empty() || positionPath_ == orientationPath_)) {
+        OSVR_LOG(warn) << "OSVRTrackedHMD::Activate(): Splitting orientation and position needs a positionPath different from the orientationPath [" << orientationPath_ << "]. Tracking the HMD from /me/head instead.";
+        splitOrientationAndPosition_ = false;
+    }
+    if (splitOrientationAndPosition_) {
+        OSVR_LOG(info) << "Tracking HMD orientation from [" << orientationPath_ << "] and position from [" << positionPath_ << "].";
+        positionFilter_.reset();
+        trackerInterface_ = context_.getInterface(orientationPath_);
+        trackerInterface_.registerCallback(&OSVRTrackedHMD::HmdOrientationCallback, this);
+        positionInterface_ = context_.getInterface(positionPath_);
+        positionInterface_.registerCallback(&OSVRTrackedHMD::HmdPositionCallback, this);
+    } else {
+        trackerInterface_ = context_.getInterface("/me/head");
+        trackerInterface_.registerCallback(&OSVRTrackedHMD::HmdTrackerCallback, this);
+    }
+    if (!ignoreVelocityReports_) {
+        trackerInterface_.registerCallback(&OSVRTrackedHMD::HmdVelocityCallback, this);
+    }
 
     OSVR_LOG(trace) << "OSVRTrackedHMD::Activate(): Activation for object ID " << object_id << " complete.\n";
     return vr::VRInitError_None;
@@ -155,11 +187,23 @@ void OSVRTrackedHMD::Deactivate()
     OSVR_LOG(trace) << "OSVRTrackedHMD::Deactivate() called.";
 
     objectId_ = vr::k_unTrackedDeviceIndexInvalid;
+    finishDistortionBuild();
+
+    if (DistortionMode::Interpolator == distortionMode_ || DistortionMode::Mesh == distortionMode_) {
+        for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+            const auto statistics = getCacheStatistics((vr::Eye_Left == eye) ? leftEyeMeshes_ : rightEyeMeshes_);
+            OSVR_LOG(info) << "Distortion triangle cache for the " << eye_name << " eye: " << statistics.hits << " hits, " << statistics.misses << " misses.";
+        }
+    }
 
     /// Have to force freeing here
     if (trackerInterface_.notEmpty()) {
         trackerInterface_.free();
     }
+    if (positionInterface_.notEmpty()) {
+        positionInterface_.free();
+    }
 }
 
 void OSVRTrackedHMD::EnterStandby()
@@ -177,20 +221,6 @@ void* OSVRTrackedHMD::GetComponent(const char* component_name_and_version)
     return nullptr;
 }
 
-void OSVRTrackedHMD::DebugRequest(const char* request, char* response_buffer, uint32_t response_buffer_size)
-{
-    // TODO
-
-    // Log the requests just to see what info clients are looking for
-    OSVR_LOG(debug) << "Received debug request [" << request << "] with response buffer size of " << response_buffer_size << "].";
-
-    // make use of (from vrtypes.h) static const uint32_t k_unMaxDriverDebugResponseSize = 32768;
-    // return empty string for now
-    if (response_buffer_size > 0) {
-        response_buffer[0] = '\0';
-    }
-}
-
 void OSVRTrackedHMD::GetWindowBounds(int32_t* x, int32_t* y, uint32_t* width, uint32_t* height)
 {
     const auto bounds = getWindowBounds(display_, scanoutOrigin_);
@@ -218,12 +248,28 @@ bool OSVRTrackedHMD::IsDisplayRealDisplay()
 
 void OSVRTrackedHMD::GetRecommendedRenderTargetSize(uint32_t* width, uint32_t* height)
 {
-    //const double overfill_factor = renderManagerConfig_.getRenderOverfillFactor();
-    const double overfill_factor = 1.0;
     const auto bounds = getWindowBounds(display_, scanoutOrigin_);
 
-    *width = static_cast<uint32_t>(bounds.width * overfill_factor);
-    *height = static_cast<uint32_t>(bounds.height * overfill_factor);
+    *width = static_cast<uint32_t>(bounds.width * overfillFactor_);
+    *height = static_cast<uint32_t>(bounds.height * overfillFactor_);
+
+    // The lens-aware size is worked out along with the distortion.
+    if (renderTargetPixelDensity_ > 0.0f) {
+        if (!distortionReady_.load(std::memory_order_acquire)) {
+            waitForDistortion("GetRecommendedRenderTargetSize()");
+        }
+        if (renderTargetSize_[0] > 0 && renderTargetSize_[1] > 0) {
+            *width = renderTargetSize_[0];
+            *height = renderTargetSize_[1];
+        }
+    }
+
+    if (renderTargetWidth_ > 0) {
+        *width = renderTargetWidth_;
+    }
+    if (renderTargetHeight_ > 0) {
+        *height = renderTargetHeight_;
+    }
     OSVR_LOG(trace) << "GetRecommendedRenderTargetSize(): width = " << *width << ", height = " << *height << ".";
 }
 
@@ -251,71 +297,86 @@ void OSVRTrackedHMD::GetProjectionRaw(vr::EVREye eye, float* left, float* right,
 
 vr::DistortionCoordinates_t OSVRTrackedHMD::ComputeDistortion(vr::EVREye eye, float u, float v)
 {
-    // Rotate the texture coordinates to match the display orientation
-    const auto orientation = scanoutOrigin_ + display_.rotation;
-    const auto desired_orientation = osvr::display::DesktopOrientation::Landscape;
-    const auto rotation = desired_orientation - orientation;
+    vr::DistortionCoordinates_t coords;
+    computeDistortion(eye, &u, &v, 1, makeDistortionBatch(coords));
+    return coords;
+}
 
-    std::tie(u, v) = rotate(u, v, rotation);
+void OSVRTrackedHMD::computeDistortion(vr::EVREye eye, const float* u, const float* v, std::size_t count, const DistortionBatch& out) const
+{
+    if (!distortionReady_.load(std::memory_order_acquire)) {
+        waitForDistortion("ComputeDistortion()");
+    }
 
-    // Note that RenderManager expects the (0, 0) to be the lower-left corner
-    // and (1, 1) to be the upper-right corner while SteamVR assumes (0, 0) is
-    // upper-left and (1, 1) is lower-right.  To accommodate this, we need to
-    // flip the y-coordinate before passing it to RenderManager and flip it
-    // again before returning the value to SteamVR.
-    using osvr::renderkit::DistortionCorrectTextureCoordinate;
-    static const size_t COLOR_RED = 0;
-    static const size_t COLOR_GREEN = 1;
-    static const size_t COLOR_BLUE = 2;
+    const auto index = static_cast<std::size_t>(eye);
+    distortionKernels_[index](distortionSources_[index], u, v, count, out);
+}
 
-    const auto osvr_eye = static_cast<size_t>(eye);
-    const auto distortion_parameters = distortionParameters_[osvr_eye];
-    const auto in_coords = osvr::renderkit::Float2 {{u, 1.0f - v}}; // flip v-coordinate
+// ------------------------------------
+// Private Methods
+// ------------------------------------
 
-    const auto interpolators = (vr::Eye_Left == eye) ? &leftEyeInterpolators_ : &rightEyeInterpolators_;
 
-    auto coords_red = DistortionCorrectTextureCoordinate(
-        osvr_eye, in_coords, distortion_parameters,
-        COLOR_RED, overfillFactor_, *interpolators);
+void OSVRTrackedHMD::HmdTrackerCallback(void* userdata, const OSVR_TimeValue* timeval, const OSVR_PoseReport* report)
+{
+    if (!userdata)
+        return;
 
-    auto coords_green = DistortionCorrectTextureCoordinate(
-        osvr_eye, in_coords, distortion_parameters,
-        COLOR_GREEN, overfillFactor_, *interpolators);
+    auto* self = static_cast<OSVRTrackedHMD*>(userdata);
+    self->reportCount_.fetch_add(1, std::memory_order_relaxed);
+    self->updatePose(*timeval, osvr::util::vecMap(report->pose.translation), osvr::util::fromQuat(report->pose.rotation));
+}
 
-    auto coords_blue = DistortionCorrectTextureCoordinate(
-        osvr_eye, in_coords, distortion_parameters,
-        COLOR_BLUE, overfillFactor_, *interpolators);
+void OSVRTrackedHMD::HmdOrientationCallback(void* userdata, const OSVR_TimeValue* timeval, const OSVR_OrientationReport* report)
+{
+    if (!userdata)
+        return;
 
-    vr::DistortionCoordinates_t coords;
-    // flip v-coordinates again
-    coords.rfRed[0] = coords_red[0];
-    coords.rfRed[1] = 1.0f - coords_red[1];
-    coords.rfGreen[0] = coords_green[0];
-    coords.rfGreen[1] = 1.0f - coords_green[1];
-    coords.rfBlue[0] = coords_blue[0];
-    coords.rfBlue[1] = 1.0f - coords_blue[1];
+    auto* self = static_cast<OSVRTrackedHMD*>(userdata);
+    self->reportCount_.fetch_add(1, std::memory_order_relaxed);
 
-    return coords;
-}
+    // Wait for the first position so we don't publish the head at the origin
+    if (!self->positionFilter_.valid())
+        return;
 
-vr::DriverPose_t OSVRTrackedHMD::GetPose()
-{
-    return pose_;
+    self->updatePose(*timeval, self->positionFilter_.getPosition(*timeval), osvr::util::fromQuat(report->rotation));
 }
 
+void OSVRTrackedHMD::HmdPositionCallback(void* userdata, const OSVR_TimeValue* timeval, const OSVR_PositionReport* report)
+{
+    if (!userdata)
+        return;
 
-// ------------------------------------
-// Private Methods
-// ------------------------------------
-
+    auto* self = static_cast<OSVRTrackedHMD*>(userdata);
+    self->positionFilter_.update(*timeval, osvr::util::vecMap(report->xyz));
+}
 
-void OSVRTrackedHMD::HmdTrackerCallback(void* userdata, const OSVR_TimeValue* timeval, const OSVR_PoseReport* report)
+void OSVRTrackedHMD::HmdVelocityCallback(void* userdata, const OSVR_TimeValue* timestamp, const OSVR_VelocityReport* report)
 {
     if (!userdata)
         return;
 
     auto* self = static_cast<OSVRTrackedHMD*>(userdata);
+    auto& velocity = self->velocity_;
+    const auto& state = report->state;
 
+    velocity.timestamp = *timestamp;
+
+    velocity.linearVelocityValid = (state.linearVelocityValid != 0);
+    if (velocity.linearVelocityValid) {
+        velocity.linearVelocity = osvr::util::vecMap(state.linearVelocity);
+    }
+
+    // Convert the incremental rotation to an angular velocity
+    const auto dt = state.angularVelocity.dt;
+    velocity.angularVelocityValid = (state.angularVelocityValid != 0) && dt > 0.0;
+    if (velocity.angularVelocityValid) {
+        velocity.angularVelocity = osvr::util::quat_ln(osvr::util::fromQuat(state.angularVelocity.incrementalRotation)) * 2.0 / dt;
+    }
+}
+
+void OSVRTrackedHMD::updatePose(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation)
+{
     vr::DriverPose_t pose;
 
     map(pose.qWorldFromDriverRotation) = Eigen::Quaterniond::Identity();
@@ -325,31 +386,36 @@ void OSVRTrackedHMD::HmdTrackerCallback(void* userdata, const OSVR_TimeValue* ti
     Eigen::Vector3d::Map(pose.vecDriverFromHeadTranslation) = Eigen::Vector3d::Zero();
 
     // Position
-    Eigen::Vector3d::Map(pose.vecPosition) = osvr::util::vecMap(report->pose.translation);
+    Eigen::Vector3d::Map(pose.vecPosition) = position;
 
     // Velocity (m/s) and angular velocity (rad/s)
     Eigen::Vector3d::Map(pose.vecVelocity) = Eigen::Vector3d::Zero();
     Eigen::Vector3d::Map(pose.vecAngularVelocity) = Eigen::Vector3d::Zero();
 
-    if (!self->ignoreVelocityReports_) {
-        OSVR_TimeValue tv;
-        OSVR_VelocityState velocity_state;
-        const auto has_velocity_state = osvrGetVelocityState(self->trackerInterface_.get(), &tv, &velocity_state);
-        if (OSVR_RETURN_SUCCESS == has_velocity_state) {
-            if (velocity_state.linearVelocityValid) {
-                std::copy(std::begin(velocity_state.linearVelocity.data), std::end(velocity_state.linearVelocity.data), std::begin(pose.vecVelocity));
+    // Use the latest velocity report unless it's too far from this pose. When
+    // position comes from its own stream, the velocity reports belong to the
+    // orientation stream, so take the linear velocity from the position
+    // filter instead.
+    bool has_velocity = false;
+    bool has_angular_velocity = false;
+    if (splitOrientationAndPosition_) {
+        Eigen::Vector3d::Map(pose.vecVelocity) = positionFilter_.getVelocity(timestamp);
+        has_velocity = true;
+    }
+
+    const auto& velocity = velocity_;
+    if (velocity.linearVelocityValid || velocity.angularVelocityValid) {
+        const auto velocity_age = std::abs(osvr::util::time::duration(timestamp, velocity.timestamp));
+        if (velocity_age <= maxVelocityAge_) {
+            if (velocity.linearVelocityValid && !splitOrientationAndPosition_) {
+                Eigen::Vector3d::Map(pose.vecVelocity) = velocity.linearVelocity;
+                has_velocity = true;
             }
 
-            if (velocity_state.angularVelocityValid) {
+            if (velocity.angularVelocityValid) {
                 // Change the reference frame
-                const auto pose_rotation = osvr::util::fromQuat(report->pose.rotation);
-                const auto inc_rotation = pose_rotation.inverse() * osvr::util::fromQuat(velocity_state.angularVelocity.incrementalRotation) * pose_rotation;
-
-                // Convert incremental rotation to angular velocity
-                const auto dt = velocity_state.angularVelocity.dt;
-                const auto angular_velocity = osvr::util::quat_ln(inc_rotation) * 2.0 / dt;
-
-                Eigen::Vector3d::Map(pose.vecAngularVelocity) = angular_velocity;
+                Eigen::Vector3d::Map(pose.vecAngularVelocity) = orientation.conjugate() * velocity.angularVelocity;
+                has_angular_velocity = true;
             }
         }
     }
@@ -358,7 +424,7 @@ void OSVRTrackedHMD::HmdTrackerCallback(void* userdata, const OSVR_TimeValue* ti
     Eigen::Vector3d::Map(pose.vecAcceleration) = Eigen::Vector3d::Zero();
 
     // Orientation
-    map(pose.qRotation) = osvr::util::fromQuat(report->pose.rotation);
+    map(pose.qRotation) = orientation;
 
     // Angular acceleration is not currently provided
     Eigen::Vector3d::Map(pose.vecAngularAcceleration) = Eigen::Vector3d::Zero();
@@ -369,15 +435,17 @@ void OSVRTrackedHMD::HmdTrackerCallback(void* userdata, const OSVR_TimeValue* ti
     pose.shouldApplyHeadModel = true;
     pose.deviceIsConnected = true;
 
+    // Fill in accelerations and missing velocities from the pose history
+    estimateMotion(pose, timestamp, has_velocity, has_angular_velocity);
+
     // Time offset of this pose, in seconds from the actual time of the pose,
     // relative to the time of the PoseUpdated() call made by the driver.
     const auto now = osvr::util::time::getNow();
-    const auto elapsed = osvr::util::time::duration(now, *timeval);
+    const auto elapsed = osvr::util::time::duration(now, timestamp);
     pose.poseTimeOffset = elapsed;
 
-    //OSVR_LOG(trace) << "OSVRTrackedHMD::HmdTrackerCallback(): Got a new head pose: " << pose.vecPosition << " at angle " << pose.qRotation << ".";
-    self->pose_ = pose;
-    vr::VRServerDriverHost()->TrackedDevicePoseUpdated(self->objectId_, self->pose_, sizeof(vr::DriverPose_t));
+    //OSVR_LOG(trace) << "OSVRTrackedHMD::updatePose(): Got a new head pose: " << pose.vecPosition << " at angle " << pose.qRotation << ".";
+    publishPose(pose, timestamp);
 }
 
 float OSVRTrackedHMD::GetIPD()
@@ -410,11 +478,51 @@ vr::ETrackedDeviceClass OSVRTrackedHMD::getDeviceClass() const
     return deviceClass_;
 }
 
+const VsyncClock& OSVRTrackedHMD::getVsyncClock() const
+{
+    return vsyncClock_;
+}
+
 void OSVRTrackedHMD::configure()
 {
     // Get settings from config file
     ignoreVelocityReports_ = settings_->getSetting<bool>("ignoreVelocityReports", false);
     OSVR_LOG(info) << (ignoreVelocityReports_ ? "Ignoring velocity reports." : "Utilizing velocity reports.");
+    maxVelocityAge_ = settings_->getSetting<float>("maxVelocityAge", 20.0f) / 1000.0;
+
+    // Distortion
+    distortionMode_ = parseDistortionMode(settings_->getSetting<std::string>("distortionMode", "interpolator"));
+    distortionTriangles_ = static_cast<std::size_t>(std::max(2, settings_->getSetting<int>("distortionTriangles", static_cast<int>(distortionTriangles_))));
+    distortionTableResolution_ = static_cast<std::size_t>(std::max(0, settings_->getSetting<int>("distortionTableResolution", 0)));
+    distortionBuildThreads_ = static_cast<std::size_t>(std::max(0, settings_->getSetting<int>("distortionBuildThreads", 0)));
+    distortionBackgroundBuild_ = settings_->getSetting<bool>("distortionBackgroundBuild", true);
+    renderTargetPixelDensity_ = std::max(0.0f, settings_->getSetting<float>("renderTargetPixelDensity", 0.0f));
+    renderTargetWidth_ = static_cast<std::uint32_t>(std::max(0, settings_->getSetting<int>("renderTargetWidth", 0)));
+    renderTargetHeight_ = static_cast<std::uint32_t>(std::max(0, settings_->getSetting<int>("renderTargetHeight", 0)));
+    distortionQuadtreeTolerance_ = std::max(0.0f, settings_->getSetting<float>("distortionQuadtreeTolerance", distortionQuadtreeTolerance_));
+    distortionQuadtreeMaxDepth_ = static_cast<std::size_t>(std::max(0, settings_->getSetting<int>("distortionQuadtreeMaxDepth", static_cast<int>(distortionQuadtreeMaxDepth_))));
+    distortionPolynomialTolerance_ = std::max(0.0f, settings_->getSetting<float>("distortionPolynomialTolerance", distortionPolynomialTolerance_));
+    distortionPolynomialMaxDegree_ = static_cast<std::size_t>(std::max(0, settings_->getSetting<int>("distortionPolynomialMaxDegree", static_cast<int>(distortionPolynomialMaxDegree_))));
+    distortionCache_ = settings_->getSetting<bool>("distortionCache", true);
+    distortionCachePath_ = settings_->getSetting<std::string>("distortionCachePath", "");
+    OSVR_LOG(info) << "Distortion mode is " << distortionMode_ << ".";
+
+    // Separate orientation and position tracking
+    splitOrientationAndPosition_ = settings_->getSetting<bool>("splitOrientationAndPosition", false);
+    orientationPath_ = settings_->getSetting<std::string>("orientationPath", orientationPath_);
+    positionPath_ = settings_->getSetting<std::string>("positionPath", positionPath_);
+    positionFilter_.setGains(settings_->getSetting<float>("positionFilterAlpha", 0.8f), settings_->getSetting<float>("positionFilterBeta", 0.4f));
+    positionFilter_.setMaxExtrapolation(settings_->getSetting<float>("positionFilterMaxExtrapolation", 100.0f) / 1000.0);
+
+    // Motion estimation
+    estimateMotion_ = settings_->getSetting<bool>("estimateMotion", false);
+    OSVR_LOG(info) << (estimateMotion_ ? "Estimating HMD motion from its pose history." : "Not estimating HMD motion.");
+
+    // Pose prediction
+    predictor_.setMode(parsePredictionMode(settings_->getSetting<std::string>("predictionMode", "off")));
+    predictor_.setLookahead(settings_->getSetting<float>("predictionLookahead", 0.0f) / 1000.0);
+    predictor_.setMaxInterval(settings_->getSetting<float>("predictionMaxInterval", 50.0f) / 1000.0);
+    OSVR_LOG(info) << "HMD prediction mode is " << predictor_.getMode() << ".";
 
     // The name of the display we want to use
     const auto display_name = settings_->getSetting<std::string>("displayName", "OSVR");
@@ -496,6 +604,10 @@ void OSVRTrackedHMD::configure()
         }
     }
 
+    // Detected displays may not report a refresh rate
+    const auto refresh_rate = (display_.verticalRefreshRate > 0.0) ? display_.verticalRefreshRate : getVerticalRefreshRate();
+    vsyncClock_.setRefreshRate(refresh_rate);
+
     // Print the display settings we're running with
     if (display_found) {
         OSVR_LOG(info) << "Detected display named [" << display_.name << "]:";
@@ -516,32 +628,512 @@ void OSVRTrackedHMD::configure()
 
 void OSVRTrackedHMD::configureDistortionParameters()
 {
+    // A previous activation may still be building its distortion.
+    finishDistortionBuild();
+
     // Parse the display descriptor
     displayDescription_ = context_.getStringParameter("/display");
     displayConfiguration_ = OSVRDisplayConfiguration(displayDescription_);
 
     // Initialize the distortion parameters
     OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Number of eyes: " << displayConfiguration_.getEyes().size() << ".";
+    distortionParameters_.clear();
     for (size_t i = 0; i < displayConfiguration_.getEyes().size(); ++i) {
         auto distortion = osvr::renderkit::DistortionParameters { displayConfiguration_, i };
-        distortion.m_desiredTriangles = 200 * 64;
+        distortion.m_desiredTriangles = static_cast<float>(distortionTriangles_);
         OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Adding distortion for eye " << i << ".";
         distortionParameters_.push_back(distortion);
     }
     OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Number of distortion parameters: " << distortionParameters_.size() << ".";
 
-    // Make the interpolators to be used by each eye.
-    OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Creating mesh interpolators for the left eye.";
-    if (!makeUnstructuredMeshInterpolators(distortionParameters_[0], 0, leftEyeInterpolators_)) {
-        OSVR_LOG(err) << "OSVRTrackedHMD::configureDistortionParameters(): Could not create mesh interpolators for left eye.";
+    // Everything else only depends on the distortion parameters and the
+    // display settings, so it needn't hold up activation. ComputeDistortion()
+    // waits for it if SteamVR asks before it's done. The cache path comes
+    // from SteamVR, so look it up here rather than on the build thread.
+    const auto cache_path = distortionCache_ ? getDistortionCachePath() : std::string();
+    // setProperties() renames display_ while the build runs, so the render
+    // target size works from a copy.
+    const auto display = display_;
+    const auto scanout_origin = scanoutOrigin_;
+    const auto display_mode = displayConfiguration_.getDisplayMode();
+    const auto build = [this, cache_path, display, scanout_origin, display_mode] {
+        try {
+            const auto start = std::chrono::steady_clock::now();
+            buildDistortion(cache_path);
+            computeRenderTargetSize(display, scanout_origin, display_mode);
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            OSVR_LOG(info) << "Built the " << distortionMode_ << " distortion in " << elapsed.count() << " ms.";
+            distortionReady_.store(true, std::memory_order_release);
+        } catch (...) {
+            // Leave ComputeDistortion() something to serve before anyone
+            // sees the build as finished, and let them report the error.
+            useFallbackDistortion();
+            throw;
+        }
+    };
+
+    // Hold the lock until the build is under way (or, without a background
+    // build, done) so that waitForDistortion() never sees the distortion as
+    // unfinished without a build to wait for.
+    std::lock_guard<std::mutex> lock(distortionBuildMutex_);
+    distortionReady_.store(false, std::memory_order_release);
+    if (distortionBackgroundBuild_) {
+        OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Building the distortion in the background.";
+        distortionBuilt_ = std::async(std::launch::async, build).share();
+    } else {
+        try {
+            build();
+        } catch (const std::exception& e) {
+            OSVR_LOG(err) << "OSVRTrackedHMD::configureDistortionParameters(): Could not build the " << distortionMode_ << " distortion: " << e.what();
+        } catch (...) {
+            OSVR_LOG(err) << "OSVRTrackedHMD::configureDistortionParameters(): Could not build the " << distortionMode_ << " distortion.";
+        }
+        distortionReady_.store(true, std::memory_order_release);
+    }
+}
+
+void OSVRTrackedHMD::computeRenderTargetSize(const osvr::display::Display& display, osvr::display::ScanOutOrigin scanout_origin, OSVRDisplayConfiguration::DisplayMode display_mode)
+{
+    renderTargetSize_ = { { 0, 0 } };
+    if (renderTargetPixelDensity_ <= 0.0f)
+        return;
+
+    // Match the pixel density at the center of each eye's viewport, where the
+    // lens magnifies the most, and size the render target for the eye that
+    // needs more.
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        const auto index = static_cast<std::size_t>(eye);
+        const auto distortion = [this, index](float u, float v) {
+            vr::DistortionCoordinates_t coords;
+            distortionKernels_[index](distortionSources_[index], &u, &v, 1, makeDistortionBatch(coords));
+            return coords;
+        };
+        const auto jacobian = getDistortionJacobian(distortion, 0.5f, 0.5f);
+        const auto viewport = getEyeOutputViewport(eye, display, scanout_origin, display_mode);
+        const auto size = getRenderTargetSize(jacobian, viewport.width, viewport.height, renderTargetPixelDensity_);
+        if (0 == size.first || 0 == size.second) {
+            OSVR_LOG(warn) << "OSVRTrackedHMD::computeRenderTargetSize(): The distortion for the " << eye_name << " eye is degenerate at its center. Using the window size instead.";
+            renderTargetSize_ = { { 0, 0 } };
+            return;
+        }
+
+        OSVR_LOG(info) << "The " << eye_name << " eye's " << viewport.width << "x" << viewport.height << " viewport needs a " << size.first << "x" << size.second
+                       << " render target for a pixel density of " << renderTargetPixelDensity_ << " at its center.";
+        renderTargetSize_[0] = std::max(renderTargetSize_[0], size.first);
+        renderTargetSize_[1] = std::max(renderTargetSize_[1], size.second);
+    }
+    OSVR_LOG(info) << "Recommended render target size is " << renderTargetSize_[0] << "x" << renderTargetSize_[1] << ".";
+}
+
+void OSVRTrackedHMD::waitForDistortion(const char* caller) const
+{
+    // Each thread has to wait through its own copy of the future.
+    std::shared_future<void> built;
+    {
+        std::lock_guard<std::mutex> lock(distortionBuildMutex_);
+        built = distortionBuilt_;
     }
-    OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Number of left eye interpolators: " << leftEyeInterpolators_.size() << ".";
+    if (!built.valid())
+        return;
 
-    OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Creating mesh interpolators for the right eye.";
-    if (!makeUnstructuredMeshInterpolators(distortionParameters_[1], 1, rightEyeInterpolators_)) {
-        OSVR_LOG(err) << "OSVRTrackedHMD::configureDistortionParameters(): Could not create mesh interpolators for right eye.";
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        built.get();
+    } catch (const std::exception& e) {
+        OSVR_LOG(err) << caller << ": Could not build the " << distortionMode_ << " distortion: " << e.what();
+    } catch (...) {
+        OSVR_LOG(err) << caller << ": Could not build the " << distortionMode_ << " distortion.";
     }
-    OSVR_LOG(debug) << "OSVRTrackedHMD::configureDistortionParameters(): Number of right eye interpolators: " << leftEyeInterpolators_.size() << ".";
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    OSVR_LOG(info) << caller << " waited " << elapsed.count() / 1000.0 << " ms for the distortion to be built.";
+    distortionReady_.store(true, std::memory_order_release);
+}
+
+void OSVRTrackedHMD::finishDistortionBuild()
+{
+    std::shared_future<void> built;
+    {
+        std::lock_guard<std::mutex> lock(distortionBuildMutex_);
+        built = distortionBuilt_;
+    }
+    if (!built.valid())
+        return;
+
+    try {
+        built.get();
+    } catch (const std::exception& e) {
+        OSVR_LOG(err) << "OSVRTrackedHMD::finishDistortionBuild(): Could not build the " << distortionMode_ << " distortion: " << e.what();
+    } catch (...) {
+        OSVR_LOG(err) << "OSVRTrackedHMD::finishDistortionBuild(): Could not build the " << distortionMode_ << " distortion.";
+    }
+
+    std::lock_guard<std::mutex> lock(distortionBuildMutex_);
+    distortionBuilt_ = std::shared_future<void>();
+    distortionReady_.store(true, std::memory_order_release);
+}
+
+void OSVRTrackedHMD::useFallbackDistortion()
+{
+    const auto rotation = getDistortionRotation();
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        const auto index = static_cast<std::size_t>(eye);
+        const auto& interpolators = (vr::Eye_Left == eye) ? leftEyeInterpolators_ : rightEyeInterpolators_;
+        if (index < distortionParameters_.size() && !interpolators.empty()) {
+            OSVR_LOG(warn) << "OSVRTrackedHMD::useFallbackDistortion(): Using the mesh interpolators for the " << eye_name << " eye.";
+            distortionSources_[index] = getDistortionSource(eye);
+            distortionKernels_[index] = getDistortionKernel(DistortionMode::Interpolator, rotation, index);
+        } else {
+            OSVR_LOG(err) << "OSVRTrackedHMD::useFallbackDistortion(): No distortion is available for the " << eye_name << " eye. Leaving it undistorted.";
+            distortionKernels_[index] = getIdentityDistortionKernel();
+        }
+    }
+}
+
+void OSVRTrackedHMD::buildDistortion(const std::string& cache_path)
+{
+    // None of the cached data needs the interpolators once it's built, so a
+    // cache hit skips the slowest part of the build entirely.
+    const auto cache_key = getDistortionCacheKey();
+    if (!cache_path.empty()) {
+        const auto start = std::chrono::steady_clock::now();
+        if (loadCachedDistortion(cache_path, cache_key)) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            OSVR_LOG(info) << "Loaded the " << distortionMode_ << " distortion from [" << cache_path << "] in " << elapsed.count() << " ms.";
+            selectDistortionKernels();
+            return;
+        }
+    }
+
+    // Make the interpolators to be used by each eye. This is the slowest
+    // part of activation, so build them all at once.
+    const auto threads = getDistortionBuildThreads(distortionBuildThreads_);
+    OSVR_LOG(debug) << "OSVRTrackedHMD::buildDistortion(): Creating mesh interpolators using " << threads << " threads.";
+    const auto start = std::chrono::steady_clock::now();
+    auto interpolators = makeMeshInterpolators(distortionParameters_, threads);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    OSVR_LOG(info) << "Created the distortion mesh interpolators in " << elapsed.count() << " ms using " << threads << " threads.";
+
+    interpolators.resize(2);
+    leftEyeInterpolators_ = std::move(interpolators[0]);
+    rightEyeInterpolators_ = std::move(interpolators[1]);
+    if (leftEyeInterpolators_.empty()) {
+        OSVR_LOG(err) << "OSVRTrackedHMD::buildDistortion(): Could not create mesh interpolators for left eye.";
+    }
+    if (rightEyeInterpolators_.empty()) {
+        OSVR_LOG(err) << "OSVRTrackedHMD::buildDistortion(): Could not create mesh interpolators for right eye.";
+    }
+    OSVR_LOG(debug) << "OSVRTrackedHMD::buildDistortion(): Number of left eye interpolators: " << leftEyeInterpolators_.size() << ".";
+    OSVR_LOG(debug) << "OSVRTrackedHMD::buildDistortion(): Number of right eye interpolators: " << rightEyeInterpolators_.size() << ".";
+
+    if (DistortionMode::Table == distortionMode_) {
+        buildDistortionTables();
+    } else if (DistortionMode::Interpolator == distortionMode_ || DistortionMode::Mesh == distortionMode_) {
+        buildDistortionMeshes();
+    } else if (DistortionMode::Quadtree == distortionMode_) {
+        buildDistortionQuadtrees();
+    } else if (DistortionMode::Polynomial == distortionMode_) {
+        buildDistortionPolynomials();
+    }
+
+    // An eye that fell back to its interpolators would have nothing to load
+    // next time, so only cache a complete build.
+    if (!cache_path.empty() && hasDistortionData(vr::Eye_Left) && hasDistortionData(vr::Eye_Right) && saveCachedDistortion(cache_path, cache_key)) {
+        OSVR_LOG(info) << "Saved the " << distortionMode_ << " distortion to [" << cache_path << "].";
+    }
+
+    selectDistortionKernels();
+    releaseUnusedInterpolators();
+}
+
+bool OSVRTrackedHMD::loadCachedDistortion(const std::string& cache_path, std::uint64_t cache_key)
+{
+    switch (distortionMode_) {
+    case DistortionMode::Interpolator:
+    case DistortionMode::Mesh:
+        return loadDistortionCache(cache_path, cache_key, leftEyeMeshes_, rightEyeMeshes_);
+    case DistortionMode::Table:
+        return loadDistortionCache(cache_path, cache_key, leftEyeTable_, rightEyeTable_);
+    case DistortionMode::Quadtree:
+        return loadDistortionCache(cache_path, cache_key, leftEyeQuadtree_, rightEyeQuadtree_);
+    case DistortionMode::Polynomial:
+        return loadDistortionCache(cache_path, cache_key, leftEyePolynomial_, rightEyePolynomial_);
+    }
+    return false;
+}
+
+bool OSVRTrackedHMD::saveCachedDistortion(const std::string& cache_path, std::uint64_t cache_key) const
+{
+    switch (distortionMode_) {
+    case DistortionMode::Interpolator:
+    case DistortionMode::Mesh:
+        return saveDistortionCache(cache_path, cache_key, leftEyeMeshes_, rightEyeMeshes_);
+    case DistortionMode::Table:
+        return saveDistortionCache(cache_path, cache_key, leftEyeTable_, rightEyeTable_);
+    case DistortionMode::Quadtree:
+        return saveDistortionCache(cache_path, cache_key, leftEyeQuadtree_, rightEyeQuadtree_);
+    case DistortionMode::Polynomial:
+        return saveDistortionCache(cache_path, cache_key, leftEyePolynomial_, rightEyePolynomial_);
+    }
+    return false;
+}
+
+std::size_t OSVRTrackedHMD::getTableResolution() const
+{
+    return (distortionTableResolution_ > 0) ? distortionTableResolution_ : getDistortionTableResolution(distortionParameters_[0].m_desiredTriangles);
+}
+
+std::string OSVRTrackedHMD::getDistortionCachePath() const
+{
+    if (!distortionCachePath_.empty())
+        return distortionCachePath_;
+
+    // Default to SteamVR's per-user config directory.
+    std::vector<char> buffer(vr::k_unMaxPropertyStringSize, '\0');
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    vr::VRProperties()->GetStringProperty(vr::VRDriverHandle(), vr::Prop_UserConfigPath_String, buffer.data(), static_cast<uint32_t>(buffer.size()), &error);
+    const std::string config_path = buffer.data();
+    if (vr::TrackedProp_Success != error || config_path.empty()) {
+        OSVR_LOG(warn) << "Could not find the user config directory. Set distortionCachePath to cache the distortion.";
+        return "";
+    }
+
+    return config_path + "/osvr_distortion.cache";
+}
+
+std::uint64_t OSVRTrackedHMD::getDistortionCacheKey() const
+{
+    // Everything the cached data depends on. The distortion mode isn't part
+    // of it: the cache records what kind of data it holds.
+    std::ostringstream key;
+    key << displayDescription_ << "\n"
+        << overfillFactor_ << "\n"
+        << distortionParameters_[0].m_desiredTriangles << "\n"
+        << getTableResolution() << "\n"
+        << distortionQuadtreeTolerance_ << "\n"
+        << distortionQuadtreeMaxDepth_ << "\n"
+        << distortionPolynomialTolerance_ << "\n"
+        << distortionPolynomialMaxDegree_ << "\n"
+        << static_cast<int>(scanoutOrigin_) << "\n"
+        << static_cast<int>(display_.rotation) << "\n"
+        << STEAMVR_OSVR_VERSION;
+    const auto str = key.str();
+    auto hash = fnv1aHash(str.data(), str.size());
+
+    // The descriptor can name a separate file of point samples, which can
+    // change without the descriptor changing, so hash the samples themselves.
+    for (std::size_t eye = 0; eye < distortionParameters_.size(); ++eye) {
+        for (const auto samples : getPointSamples(distortionParameters_[eye], eye)) {
+            hash = fnv1aHash(samples->data(), samples->size() * sizeof(samples->front()), hash);
+        }
+    }
+    return hash;
+}
+
+void OSVRTrackedHMD::buildDistortionTables()
+{
+    const auto resolution = getTableResolution();
+    const auto threads = getDistortionBuildThreads(distortionBuildThreads_);
+
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        auto& table = (vr::Eye_Left == eye) ? leftEyeTable_ : rightEyeTable_;
+        const auto reference = [this, eye](float u, float v) { return computeInterpolatorDistortion(eye, u, v); };
+
+        const auto start = std::chrono::steady_clock::now();
+        table.build(resolution, resolution, makeBatchFunction(reference), threads);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        const auto max_error = table.getMaxError(reference);
+        OSVR_LOG(info) << "Built a " << resolution << "x" << resolution << " distortion table for the " << eye_name << " eye in " << elapsed.count() << " ms. Maximum error is " << max_error << ".";
+    }
+}
+
+void OSVRTrackedHMD::buildDistortionQuadtrees()
+{
+    const auto threads = getDistortionBuildThreads(distortionBuildThreads_);
+    // For comparison: a lookup table stores six floats per node.
+    const auto table_bytes = getTableResolution() * getTableResolution() * 6 * sizeof(float);
+
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        auto& quadtree = (vr::Eye_Left == eye) ? leftEyeQuadtree_ : rightEyeQuadtree_;
+        const auto reference = [this, eye](float u, float v) { return computeInterpolatorDistortion(eye, u, v); };
+
+        const auto start = std::chrono::steady_clock::now();
+        quadtree.build(makeBatchFunction(reference), distortionQuadtreeTolerance_, distortionQuadtreeMaxDepth_, threads);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        const auto max_error = quadtree.getMaxError(reference);
+        OSVR_LOG(info) << "Built a distortion quadtree for the " << eye_name << " eye in " << elapsed.count() << " ms: " << quadtree.getLeafCount() << " leaves, "
+                       << quadtree.getDepth() << " levels deep, " << quadtree.getMemoryUsage() << " bytes (" << table_bytes << " for a lookup table). Maximum error is " << max_error << ".";
+    }
+}
+
+void OSVRTrackedHMD::buildDistortionPolynomials()
+{
+    // The eyes are independent, so fit them side by side.
+    const auto threads = getDistortionBuildThreads(distortionBuildThreads_);
+    std::array<double, 2> errors;
+    std::array<std::chrono::milliseconds, 2> elapsed;
+    parallelFor(2, threads, [&](std::size_t index) {
+        const auto eye = static_cast<vr::EVREye>(index);
+        auto& polynomial = (vr::Eye_Left == eye) ? leftEyePolynomial_ : rightEyePolynomial_;
+        const auto reference = [this, eye](float u, float v) { return computeInterpolatorDistortion(eye, u, v); };
+
+        const auto start = std::chrono::steady_clock::now();
+        polynomial = fitDistortionPolynomial(reference, distortionPolynomialTolerance_, distortionPolynomialMaxDegree_, errors[index]);
+        elapsed[index] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    });
+
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        const auto& polynomial = (vr::Eye_Left == eye) ? leftEyePolynomial_ : rightEyePolynomial_;
+        const auto index = static_cast<std::size_t>(eye);
+        if (polynomial.empty()) {
+            OSVR_LOG(warn) << "OSVRTrackedHMD::buildDistortionPolynomials(): No distortion model for the " << eye_name << " eye is within " << distortionPolynomialTolerance_
+                           << " (best error " << errors[index] << "). Falling back to the mesh interpolators.";
+            continue;
+        }
+        OSVR_LOG(info) << "Fitted a " << polynomial.getModel() << " distortion model for the " << eye_name << " eye in " << elapsed[index].count() << " ms. Maximum error is " << errors[index] << ".";
+        OSVR_LOG(info) << "  Model: " << polynomial;
+    }
+}
+
+void OSVRTrackedHMD::buildDistortionMeshes()
+{
+    // Like the interpolators, the meshes don't depend on each other.
+    const auto threads = getDistortionBuildThreads(distortionBuildThreads_);
+    const auto start = std::chrono::steady_clock::now();
+    auto meshes = makeDistortionMeshes(distortionParameters_, threads);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    meshes.resize(2);
+    leftEyeMeshes_ = std::move(meshes[0]);
+    rightEyeMeshes_ = std::move(meshes[1]);
+
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto eye_name = (vr::Eye_Left == eye) ? "left" : "right";
+        const auto& eye_meshes = (vr::Eye_Left == eye) ? leftEyeMeshes_ : rightEyeMeshes_;
+        if (eye_meshes.empty()) {
+            OSVR_LOG(err) << "OSVRTrackedHMD::buildDistortionMeshes(): Could not triangulate the distortion for the " << eye_name << " eye. Falling back to the mesh interpolators.";
+            continue;
+        }
+
+        const auto mesh = [this, eye](float u, float v) { return computeTriangulatedDistortion(eye, u, v); };
+        const auto reference = [this, eye](float u, float v) { return computeInterpolatorDistortion(eye, u, v); };
+        const auto max_error = getMaxDistortionError(mesh, reference, 64, 64);
+        std::size_t bytes = 0;
+        for (const auto& mesh : eye_meshes) {
+            bytes += mesh.getMemoryUsage();
+        }
+        OSVR_LOG(info) << "Triangulated the distortion for the " << eye_name << " eye into " << eye_meshes.front().getTriangleCount() << " triangles (" << bytes
+                       << " bytes). Maximum difference from the interpolators is " << max_error << ".";
+    }
+
+    // Only count SteamVR's queries in the triangle cache statistics.
+    for (auto& mesh : leftEyeMeshes_) {
+        mesh.resetCacheStatistics();
+    }
+    for (auto& mesh : rightEyeMeshes_) {
+        mesh.resetCacheStatistics();
+    }
+    OSVR_LOG(info) << "Built the distortion meshes in " << elapsed.count() << " ms using " << threads << " threads.";
+}
+
+osvr::display::Rotation OSVRTrackedHMD::getDistortionRotation() const
+{
+    // Rotate the texture coordinates to match the display orientation
+    const auto orientation = scanoutOrigin_ + display_.rotation;
+    const auto desired_orientation = osvr::display::DesktopOrientation::Landscape;
+    return desired_orientation - orientation;
+}
+
+DistortionSource OSVRTrackedHMD::getDistortionSource(vr::EVREye eye) const
+{
+    DistortionSource source;
+    source.parameters = &distortionParameters_[static_cast<std::size_t>(eye)];
+    source.interpolators = (vr::Eye_Left == eye) ? &leftEyeInterpolators_ : &rightEyeInterpolators_;
+    source.table = (vr::Eye_Left == eye) ? &leftEyeTable_ : &rightEyeTable_;
+    source.meshes = (vr::Eye_Left == eye) ? &leftEyeMeshes_ : &rightEyeMeshes_;
+    source.quadtree = (vr::Eye_Left == eye) ? &leftEyeQuadtree_ : &rightEyeQuadtree_;
+    source.polynomial = (vr::Eye_Left == eye) ? &leftEyePolynomial_ : &rightEyePolynomial_;
+    source.overfillFactor = overfillFactor_;
+    return source;
+}
+
+bool OSVRTrackedHMD::hasDistortionData(vr::EVREye eye) const
+{
+    const auto source = getDistortionSource(eye);
+    switch (distortionMode_) {
+    case DistortionMode::Interpolator:
+        // Served from the triangulated point samples, like the mesh mode.
+        return !source.meshes->empty();
+    case DistortionMode::Table:
+        return !source.table->empty();
+    case DistortionMode::Mesh:
+        return !source.meshes->empty();
+    case DistortionMode::Quadtree:
+        return !source.quadtree->empty();
+    case DistortionMode::Polynomial:
+        return !source.polynomial->empty();
+    }
+    return false;
+}
+
+void OSVRTrackedHMD::releaseUnusedInterpolators()
+{
+    // An eye whose data couldn't be built falls back to its interpolators.
+    const auto before = getResidentMemory();
+    std::size_t released = 0;
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        auto& interpolators = (vr::Eye_Left == eye) ? leftEyeInterpolators_ : rightEyeInterpolators_;
+        if (!hasDistortionData(eye) || interpolators.empty())
+            continue;
+        released += interpolators.size();
+        MeshInterpolators().swap(interpolators);
+    }
+    if (0 == released)
+        return;
+
+    trimHeap();
+    const auto after = getResidentMemory();
+    OSVR_LOG(info) << "Freed " << released << " mesh interpolators the " << distortionMode_ << " distortion doesn't use. Resident memory went from "
+                   << before / 1024 << " KiB to " << after / 1024 << " KiB after trimming the heap.";
+}
+
+void OSVRTrackedHMD::selectDistortionKernels()
+{
+    const auto rotation = getDistortionRotation();
+    for (const auto eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const auto index = static_cast<std::size_t>(eye);
+        distortionSources_[index] = getDistortionSource(eye);
+        auto mode = DistortionMode::Interpolator;
+        if (hasDistortionData(eye)) {
+            // The interpolator mode is served from the same triangulation of
+            // the point samples as the mesh mode.
+            mode = (DistortionMode::Interpolator == distortionMode_) ? DistortionMode::Mesh : distortionMode_;
+        }
+        distortionKernels_[index] = getDistortionKernel(mode, rotation, index);
+    }
+    OSVR_LOG(debug) << "OSVRTrackedHMD::selectDistortionKernels(): Selected the distortion kernels for a rotation of " << rotation << ".";
+}
+
+vr::DistortionCoordinates_t OSVRTrackedHMD::computeTriangulatedDistortion(vr::EVREye eye, float u, float v) const
+{
+    vr::DistortionCoordinates_t coords;
+    const auto kernel = getDistortionKernel(DistortionMode::Mesh, getDistortionRotation(), static_cast<std::size_t>(eye));
+    kernel(getDistortionSource(eye), &u, &v, 1, makeDistortionBatch(coords));
+    return coords;
+}
+
+vr::DistortionCoordinates_t OSVRTrackedHMD::computeInterpolatorDistortion(vr::EVREye eye, float u, float v) const
+{
+    vr::DistortionCoordinates_t coords;
+    const auto kernel = getDistortionKernel(DistortionMode::Interpolator, getDistortionRotation(), static_cast<std::size_t>(eye));
+    kernel(getDistortionSource(eye), &u, &v, 1, makeDistortionBatch(coords));
+    return coords;
 }
 
 osvr::display::ScanOutOrigin OSVRTrackedHMD::parseScanOutOrigin(std::string str) const
@@ -597,24 +1189,6 @@ double OSVRTrackedHMD::getVerticalRefreshRate() const
     }
 }
 
-std::pair<float, float> OSVRTrackedHMD::rotate(float u, float v, osvr::display::Rotation rotation) const
-{
-    // Rotates normalized coordinates counter-clockwise
-    using R = osvr::display::Rotation;
-    if (R::Zero == rotation) {
-        return { u, v };
-    } else if (R::Ninety == rotation) {
-        return { 1.0f - v, u };
-    } else if (R::OneEighty == rotation) {
-        return { 1.0f - u, 1.0f - v };
-    } else if (R::TwoSeventy == rotation) {
-        return { v, 1.0f - u };
-    } else {
-        OSVR_LOG(err) << "Unknown rotation [" << rotation << "] Assuming 0 degrees.";
-        return { u, v };
-    }
-}
-
 void OSVRTrackedHMD::setProperties()
 {
     propertyContainer_ = vr::VRProperties()->TrackedDeviceToPropertyContainer(objectId_);
@@ -26,14 +26,22 @@
 #define INCLUDED_OSVRTrackedHMD_h_GUID_128E3B29_F5FC_4221_9B38_14E3F402E645
 
 // Internal Includes
+#include "Distortion.h"
+#include "DistortionKernel.h"
+#include "DistortionMesh.h"
 #include "OSVRTrackedDevice.h"
 #include "osvr_compiler_detection.h"    // for OSVR_OVERRIDE
+#include "PositionFilter.h"
 #include "Settings.h"
+#include "VsyncClock.h"
 
 // OpenVR includes
 #include <openvr_driver.h>
 
 // Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
 #include <osvr/ClientKit/Display.h>
 #include <osvr/Client/RenderManagerConfig.h>
 #include <osvr/Display/Display.h>
@@ -42,8 +50,14 @@
 #include <osvr/RenderKit/osvr_display_configuration.h>
 
 // Standard includes
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <map>
 
@@ -87,14 +101,6 @@ public:
      */
     virtual void* GetComponent(const char* component_name_and_version) OSVR_OVERRIDE;
 
-    /**
-     * A VR Client has made this debug request of the driver. The set of valid
-     * requests is entirely up to the driver and the client to figure out, as is
-     * the format of the response. Responses that exceed the length of the
-     * supplied buffer should be truncated and null terminated.
-     */
-    virtual void DebugRequest(const char* request, char* response_buffer, uint32_t response_buffer_size) OSVR_OVERRIDE;
-
     // ------------------------------------
     // Display Methods
     // ------------------------------------
@@ -139,14 +145,21 @@ public:
      */
     virtual vr::DistortionCoordinates_t ComputeDistortion(vr::EVREye eye, float u, float v) OSVR_OVERRIDE;
 
-    // ------------------------------------
-    // Tracking Methods
-    // ------------------------------------
-    virtual vr::DriverPose_t GetPose() OSVR_OVERRIDE;
+    /**
+     * Batched version of ComputeDistortion(): computes the distortion of the
+     * @c count points (u[i], v[i]) for the specified eye into @c out.
+     */
+    void computeDistortion(vr::EVREye eye, const float* u, const float* v, std::size_t count, const DistortionBatch& out) const;
 
     const char* getId();
     vr::ETrackedDeviceClass getDeviceClass() const;
 
+    /**
+     * Returns the vsync predictor for this HMD's display. It becomes valid
+     * once the HMD has been activated.
+     */
+    const VsyncClock& getVsyncClock() const;
+
 private:
     /**
      * Callback function which is called whenever new data has been received
@@ -154,6 +167,25 @@ private:
      */
     static void HmdTrackerCallback(void* userdata, const OSVR_TimeValue* timestamp, const OSVR_PoseReport* report);
 
+    /**
+     * Callback function which is called whenever new velocity data has been
+     * received from the tracker.
+     */
+    static void HmdVelocityCallback(void* userdata, const OSVR_TimeValue* timestamp, const OSVR_VelocityReport* report);
+
+    /**
+     * Callback functions used instead of HmdTrackerCallback() when orientation
+     * and position are tracked separately. A pose is published for each
+     * orientation report, using the filtered position at that time.
+     */
+    static void HmdOrientationCallback(void* userdata, const OSVR_TimeValue* timestamp, const OSVR_OrientationReport* report);
+    static void HmdPositionCallback(void* userdata, const OSVR_TimeValue* timestamp, const OSVR_PositionReport* report);
+
+    /**
+     * Builds a pose from the tracker data and publishes it.
+     */
+    void updatePose(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation);
+
     float GetIPD();
 
     /**
@@ -164,10 +196,49 @@ private:
     void setProperties();
 
     /**
-     * Configure RenderManager and distortion parameters.
+     * Configure RenderManager and distortion parameters, and start building
+     * the distortion data for the distortion mode.
      */
     void configureDistortionParameters();
 
+    /**
+     * Builds the distortion data for the distortion mode and selects the
+     * distortion kernels. Runs in the background unless the
+     * distortionBackgroundBuild setting is off.
+     *
+     * @param cache_path the distortion cache file, or empty to not use it
+     */
+    void buildDistortion(const std::string& cache_path);
+
+    /**
+     * Works out the render target size for the renderTargetPixelDensity
+     * setting from the distortion's magnification. Runs after the distortion
+     * has been built.
+     *
+     * @param display the display as it was when the build started
+     * @param scanout_origin the display's scan-out origin
+     * @param display_mode how the eyes share the display
+     */
+    void computeRenderTargetSize(const osvr::display::Display& display, osvr::display::ScanOutOrigin scanout_origin, OSVRDisplayConfiguration::DisplayMode display_mode);
+
+    /**
+     * Blocks until the distortion build has finished, logging how long that
+     * took, and why the build failed if it did, on behalf of @c caller.
+     */
+    void waitForDistortion(const char* caller) const;
+
+    /**
+     * Blocks until the distortion build, if any, has finished, and logs why
+     * it failed if it did.
+     */
+    void finishDistortionBuild();
+
+    /**
+     * Serves the distortion from the mesh interpolators, or leaves an eye
+     * undistorted if it has none. Used when building the distortion fails.
+     */
+    void useFallbackDistortion();
+
     /**
      * Parses a string into a scan-out origin option.
      */
@@ -179,10 +250,94 @@ private:
     double getVerticalRefreshRate() const;
 
     /**
-     * Rotates a normalized (u, v) texture coordinate by a rotation
-     * (counter-clockwise).
+     * Returns the resolution of the distortion lookup tables.
+     */
+    std::size_t getTableResolution() const;
+
+    /**
+     * Returns the path of the distortion cache file, or an empty string if
+     * there's nowhere to put it.
+     */
+    std::string getDistortionCachePath() const;
+
+    /**
+     * Returns a hash of everything the distortion data is built from,
+     * including the point samples, used to tell whether the cache is out of
+     * date.
+     */
+    std::uint64_t getDistortionCacheKey() const;
+
+    /**
+     * Loads the distortion mode's data for both eyes from the distortion
+     * cache. Returns @c false if the cache is missing or out of date.
+     */
+    bool loadCachedDistortion(const std::string& cache_path, std::uint64_t cache_key);
+
+    /**
+     * Saves the distortion mode's data for both eyes to the distortion cache.
+     */
+    bool saveCachedDistortion(const std::string& cache_path, std::uint64_t cache_key) const;
+
+    /**
+     * Bakes the distortion lookup tables from the mesh interpolators.
+     */
+    void buildDistortionTables();
+
+    /**
+     * Triangulates the distortion point samples.
+     */
+    void buildDistortionMeshes();
+
+    /**
+     * Bakes the distortion quadtrees from the mesh interpolators.
+     */
+    void buildDistortionQuadtrees();
+
+    /**
+     * Fits closed-form models to the mesh interpolators.
+     */
+    void buildDistortionPolynomials();
+
+    /**
+     * Returns the rotation from SteamVR's texture coordinates to the
+     * display's.
+     */
+    osvr::display::Rotation getDistortionRotation() const;
+
+    /**
+     * Returns the distortion data of one eye for the kernels.
+     */
+    DistortionSource getDistortionSource(vr::EVREye eye) const;
+
+    /**
+     * Picks the distortion kernel for each eye from the distortion mode and
+     * display rotation, falling back to the mesh interpolators if the mode's
+     * data couldn't be built. The interpolator mode uses the mesh kernel.
      */
-    std::pair<float, float> rotate(float u, float v, osvr::display::Rotation rotation) const;
+    void selectDistortionKernels();
+
+    /**
+     * Returns @c true if the data the distortion mode needs for @c eye has
+     * been built.
+     */
+    bool hasDistortionData(vr::EVREye eye) const;
+
+    /**
+     * Frees the mesh interpolators of each eye whose distortion kernel doesn't
+     * need them any more, trims the heap and logs the resident memory before
+     * and after.
+     */
+    void releaseUnusedInterpolators();
+
+    /**
+     * Computes the distortion with the triangulated point samples.
+     */
+    vr::DistortionCoordinates_t computeTriangulatedDistortion(vr::EVREye eye, float u, float v) const;
+
+    /**
+     * Computes the distortion with RenderManager's mesh interpolators.
+     */
+    vr::DistortionCoordinates_t computeInterpolatorDistortion(vr::EVREye eye, float u, float v) const;
 
     /**
      * Returns the model number of the HMD.
@@ -199,14 +354,44 @@ private:
     osvr::client::RenderManagerConfig renderManagerConfig_;
     vr::IVRServerDriverHost* driverHost_ = nullptr;
     osvr::clientkit::Interface trackerInterface_;
+    osvr::clientkit::Interface positionInterface_;
+    PositionFilter positionFilter_;
     std::vector<osvr::renderkit::DistortionParameters> distortionParameters_;
     OSVRDisplayConfiguration displayConfiguration_;
 
     // per-eye mesh interpolators
-    using MeshInterpolators = std::vector<std::unique_ptr<osvr::renderkit::UnstructuredMeshInterpolator>>;
     MeshInterpolators leftEyeInterpolators_;
     MeshInterpolators rightEyeInterpolators_;
 
+    // per-eye distortion lookup tables
+    DistortionLookupTable leftEyeTable_;
+    DistortionLookupTable rightEyeTable_;
+
+    // per-eye triangulated distortion samples
+    DistortionMeshes leftEyeMeshes_;
+    DistortionMeshes rightEyeMeshes_;
+
+    // per-eye adaptive distortion quadtrees
+    DistortionQuadtree leftEyeQuadtree_;
+    DistortionQuadtree rightEyeQuadtree_;
+
+    // per-eye closed-form distortion models
+    DistortionPolynomial leftEyePolynomial_;
+    DistortionPolynomial rightEyePolynomial_;
+
+    // render target size computed by computeRenderTargetSize(), zero if unset
+    std::array<std::uint32_t, 2> renderTargetSize_ = { { 0, 0 } };
+
+    // the background distortion build and whether it's finished; the mutex
+    // guards the future
+    mutable std::mutex distortionBuildMutex_;
+    std::shared_future<void> distortionBuilt_;
+    mutable std::atomic<bool> distortionReady_ { false };
+
+    // per-eye distortion kernels, picked by selectDistortionKernels()
+    std::array<DistortionKernel, 2> distortionKernels_ = { { getIdentityDistortionKernel(), getIdentityDistortionKernel() } };
+    std::array<DistortionSource, 2> distortionSources_;
+
     float overfillFactor_ = 1.0; // TODO get from RenderManager
 
     // Settings
@@ -214,6 +399,40 @@ private:
     osvr::display::Display display_ = {};
     osvr::display::ScanOutOrigin scanoutOrigin_ = osvr::display::ScanOutOrigin::UpperLeft;
     bool ignoreVelocityReports_ = false;
+    DistortionMode distortionMode_ = DistortionMode::Interpolator;
+    std::size_t distortionTriangles_ = 200 * 64; // table mode only; see distortion_sweep
+    std::size_t distortionTableResolution_ = 0; // 0 = derive from the mesh density
+    std::size_t distortionBuildThreads_ = 0; // 0 = one per hardware thread
+    bool distortionBackgroundBuild_ = true;
+    float renderTargetPixelDensity_ = 0.0f; // 0 = the window size
+    std::uint32_t renderTargetWidth_ = 0; // 0 = computed
+    std::uint32_t renderTargetHeight_ = 0; // 0 = computed
+    float distortionQuadtreeTolerance_ = 0.0005f; // texture coordinate units
+    std::size_t distortionQuadtreeMaxDepth_ = 8;
+    float distortionPolynomialTolerance_ = 0.0005f; // texture coordinate units
+    std::size_t distortionPolynomialMaxDegree_ = 5;
+    bool distortionCache_ = true;
+    std::string distortionCachePath_; // empty = in the user config directory
+    double maxVelocityAge_ = 0.02; // seconds
+    bool splitOrientationAndPosition_ = false;
+    std::string orientationPath_ = "/me/head";
+    std::string positionPath_; // must be set, and differ from orientationPath_, to split
+
+    /**
+     * The latest velocity report. The angular velocity is kept in the world
+     * frame; the pose callback rotates it into the frame of each pose. Only
+     * touched by the client update thread.
+     */
+    struct VelocitySample {
+        OSVR_TimeValue timestamp;
+        Eigen::Vector3d linearVelocity;
+        Eigen::Vector3d angularVelocity;
+        bool linearVelocityValid;
+        bool angularVelocityValid;
+    };
+    VelocitySample velocity_ = {};
+
+    VsyncClock vsyncClock_;
 };
 
 #endif // INCLUDED_OSVRTrackedHMD_h_GUID_128E3B29_F5FC_4221_9B38_14E3F402E645
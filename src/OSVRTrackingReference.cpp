@@ -40,9 +40,12 @@
 #include <osvr/ClientKit/InterfaceStateC.h>
 #include <osvr/Util/EigenInterop.h>
 #include <osvr/Util/PlatformConfig.h>
+#include <osvr/Util/TimeValue.h>
 #include <util/FixedLengthStringFunctions.h>
 
 // Standard includes
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <ctime>
 #include <string>
@@ -107,21 +110,6 @@ void* OSVRTrackingReference::GetComponent(const char* component_name_and_version
     return nullptr;
 }
 
-void OSVRTrackingReference::DebugRequest(const char* request, char* response_buffer, uint32_t response_buffer_size)
-{
-    // TODO
-    // make use of (from vrtypes.h) static const uint32_t k_unMaxDriverDebugResponseSize = 32768;
-    // return empty string for now
-    if (response_buffer_size > 0) {
-        response_buffer[0] = '\0';
-    }
-}
-
-vr::DriverPose_t OSVRTrackingReference::GetPose()
-{
-    return pose_;
-}
-
 void OSVRTrackingReference::setProperties()
 {
     propertyContainer_ = vr::VRProperties()->TrackedDeviceToPropertyContainer(objectId_);
@@ -166,6 +154,7 @@ void OSVRTrackingReference::TrackerCallback(void* userdata, const OSVR_TimeValue
         return;
 
     auto* self = static_cast<OSVRTrackingReference*>(userdata);
+    self->reportCount_.fetch_add(1, std::memory_order_relaxed);
 
     vr::DriverPose_t pose;
     pose.poseTimeOffset = 0; // close enough
@@ -194,9 +183,13 @@ void OSVRTrackingReference::TrackerCallback(void* userdata, const OSVR_TimeValue
     pose.shouldApplyHeadModel = false;
     pose.deviceIsConnected = true;
 
+    if (!self->stabilizePose(pose, *timestamp))
+        return;
+
+    self->estimateMotion(pose, *timestamp, false, false);
+
     //OSVR_LOG(trace) << "OSVRTrackingReference::TrackerCallback(): Got a new camera pose: " << pose.vecPosition << " at angle " << pose.qRotation << ".";
-    self->pose_ = pose;
-    vr::VRServerDriverHost()->TrackedDevicePoseUpdated(self->objectId_, self->pose_, sizeof(vr::DriverPose_t));
+    self->publishPose(pose, *timestamp);
 }
 
 void OSVRTrackingReference::configure()
@@ -211,6 +204,96 @@ void OSVRTrackingReference::configure()
     fovBottom_ = settings_->getSetting<float>("cameraFOVBottomDegrees", fovBottom_);
     minTrackingRange_ = settings_->getSetting<float>("minTrackingRangeMeters", minTrackingRange_);
     maxTrackingRange_ = settings_->getSetting<float>("maxTrackingRangeMeters", maxTrackingRange_);
+
+    // The camera is usually bolted down, so only publish its pose when it
+    // moves.
+    suppressStaticPoses_ = settings_->getSetting<bool>("cameraSuppressStaticPoses", suppressStaticPoses_);
+    stabilizationSamples_ = static_cast<std::size_t>(std::max(1, settings_->getSetting<int>("cameraStabilizationSamples", static_cast<int>(stabilizationSamples_))));
+    translationThreshold_ = settings_->getSetting<float>("cameraTranslationThreshold", static_cast<float>(translationThreshold_ * 1000.0)) / 1000.0;
+    rotationThreshold_ = settings_->getSetting<float>("cameraRotationThreshold", static_cast<float>(rotationThreshold_));
+    heartbeatPeriod_ = settings_->getSetting<float>("cameraHeartbeatPeriod", static_cast<float>(heartbeatPeriod_ * 1000.0)) / 1000.0;
+    sampleCount_ = 0;
+    hasStablePose_ = false;
+
+    // The camera doesn't report velocities and is usually stationary, so
+    // motion estimation and prediction are off by default.
+    estimateMotion_ = settings_->getSetting<bool>("cameraEstimateMotion", false);
+    predictor_.setMode(parsePredictionMode(settings_->getSetting<std::string>("cameraPredictionMode", "off")));
+    predictor_.setLookahead(settings_->getSetting<float>("cameraPredictionLookahead", 0.0f) / 1000.0);
+    predictor_.setMaxInterval(settings_->getSetting<float>("cameraPredictionMaxInterval", 50.0f) / 1000.0);
+}
+
+bool OSVRTrackingReference::stabilizePose(vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp)
+{
+    if (!suppressStaticPoses_)
+        return true;
+
+    const Eigen::Vector3d position = Eigen::Vector3d::Map(pose.vecPosition);
+    const Eigen::Quaterniond orientation = map(pose.qRotation);
+
+    if (hasStablePose_) {
+        if (isNear(position, orientation, stablePosition_, Eigen::Quaterniond(stableOrientation_))) {
+            if (heartbeatPeriod_ <= 0.0 || osvr::util::time::duration(timestamp, lastPublished_) < heartbeatPeriod_)
+                return false;
+
+            // Heartbeat
+            Eigen::Vector3d::Map(pose.vecPosition) = stablePosition_;
+            map(pose.qRotation) = Eigen::Quaterniond(stableOrientation_);
+            lastPublished_ = timestamp;
+            return true;
+        }
+
+        // The camera was moved. Publish poses as they come until it settles.
+        OSVR_LOG(debug) << "OSVRTrackingReference::stabilizePose(): Camera moved.";
+        hasStablePose_ = false;
+        sampleCount_ = 0;
+    }
+
+    // Restart the average while the camera is still moving.
+    if (sampleCount_ > 0) {
+        const Eigen::Vector3d mean_position = positionSum_ / static_cast<double>(sampleCount_);
+        const Eigen::Quaterniond mean_orientation(Eigen::Vector4d(orientationSum_.normalized()));
+        if (!isNear(position, orientation, mean_position, mean_orientation)) {
+            sampleCount_ = 0;
+        }
+    }
+
+    if (0 == sampleCount_) {
+        positionSum_ = Eigen::Vector3d::Zero();
+        orientationSum_ = Eigen::Vector4d::Zero();
+    }
+
+    // Average quaternions by summing them in the same hemisphere and
+    // normalizing, which is accurate for nearby orientations.
+    positionSum_ += position;
+    if (orientationSum_.dot(orientation.coeffs()) < 0.0) {
+        orientationSum_ -= orientation.coeffs();
+    } else {
+        orientationSum_ += orientation.coeffs();
+    }
+    ++sampleCount_;
+
+    if (sampleCount_ >= stabilizationSamples_) {
+        // Settled: publish the average from now on.
+        hasStablePose_ = true;
+        stablePosition_ = positionSum_ / static_cast<double>(sampleCount_);
+        stableOrientation_ = Eigen::Quaterniond(Eigen::Vector4d(orientationSum_.normalized()));
+
+        Eigen::Vector3d::Map(pose.vecPosition) = stablePosition_;
+        map(pose.qRotation) = Eigen::Quaterniond(stableOrientation_);
+        OSVR_LOG(debug) << "OSVRTrackingReference::stabilizePose(): Camera settled after " << sampleCount_ << " samples.";
+    }
+
+    // Not settled yet: publish the raw pose.
+    lastPublished_ = timestamp;
+    return true;
+}
+
+bool OSVRTrackingReference::isNear(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, const Eigen::Vector3d& reference_position, const Eigen::Quaterniond& reference_orientation) const
+{
+    const auto translation = (position - reference_position).norm();
+    const auto rotation = reference_orientation.angularDistance(orientation) * 180.0 / M_PI;
+    return translation <= translationThreshold_ && rotation <= rotationThreshold_;
 }
 
 std::string OSVRTrackingReference::getTrackerPath() const
@@ -34,9 +34,13 @@
 #include <openvr_driver.h>
 
 // Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
 #include <osvr/ClientKit/ClientKit.h>
 
 // Standard includes
+#include <cstddef>
 #include <string>
 #include <memory>
 
@@ -80,19 +84,6 @@ public:
      */
     virtual void* GetComponent(const char* component_name_and_version) OSVR_OVERRIDE;
 
-    /**
-     * A VR Client has made this debug request of the driver. The set of valid
-     * requests is entirely up to the driver and the client to figure out, as is
-     * the format of the response. Responses that exceed the length of the
-     * supplied buffer should be truncated and null terminated.
-     */
-    virtual void DebugRequest(const char* request, char* response_buffer, uint32_t response_buffer_size) OSVR_OVERRIDE;
-
-    // ------------------------------------
-    // Tracking Methods
-    // ------------------------------------
-    virtual vr::DriverPose_t GetPose() OSVR_OVERRIDE;
-
     const char* getId();
     vr::ETrackedDeviceClass getDeviceClass() const;
 
@@ -111,6 +102,23 @@ private:
      */
     std::string getTrackerPath() const;
 
+    /**
+     * Decides whether a camera pose needs to be published. Poses are averaged
+     * as long as each one stays within the thresholds of the running mean;
+     * one that doesn't restarts the average. Until the average covers enough
+     * samples, every pose is published as is. Once it does, the average is
+     * published once and after that only as a heartbeat, until a pose moves
+     * past the thresholds and the camera is treated as moving again. May
+     * replace @c pose with the stable pose.
+     */
+    bool stabilizePose(vr::DriverPose_t& pose, const OSVR_TimeValue& timestamp);
+
+    /**
+     * Returns @c true if a pose is within the translation and rotation
+     * thresholds of a reference pose.
+     */
+    bool isNear(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, const Eigen::Vector3d& reference_position, const Eigen::Quaterniond& reference_orientation) const;
+
     osvr::clientkit::Interface m_TrackerInterface;
 
     // Settings
@@ -125,6 +133,21 @@ private:
 
     float minTrackingRange_ = 0.15f; // meters
     float maxTrackingRange_ = 1.5f; // meters
+
+    bool suppressStaticPoses_ = true;
+    std::size_t stabilizationSamples_ = 30;
+    double translationThreshold_ = 0.005; // meters
+    double rotationThreshold_ = 0.5; // degrees
+    double heartbeatPeriod_ = 1.0; // seconds
+
+    // Static pose state, only touched by the client update thread
+    std::size_t sampleCount_ = 0;
+    Eigen::Matrix<double, 3, 1, Eigen::DontAlign> positionSum_ = Eigen::Vector3d::Zero();
+    Eigen::Matrix<double, 4, 1, Eigen::DontAlign> orientationSum_ = Eigen::Vector4d::Zero();
+    bool hasStablePose_ = false;
+    Eigen::Matrix<double, 3, 1, Eigen::DontAlign> stablePosition_ = Eigen::Vector3d::Zero();
+    Eigen::Quaternion<double, Eigen::DontAlign> stableOrientation_ = Eigen::Quaterniond::Identity();
+    OSVR_TimeValue lastPublished_ = {};
 };
 
 #endif // INCLUDED_OSVRTrackingReference_h_GUID_4D3F2E76_D0A2_4876_A7E9_CF0E772B02EF
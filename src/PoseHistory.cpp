@@ -0,0 +1,181 @@
+/** @file
+    @brief Recent pose history with lookup by time.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PoseHistory.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValue.h>
+
+// Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+const std::size_t PoseHistory::Capacity;
+const double PoseHistory::MaxExtrapolation = 0.1;
+
+void PoseHistory::insert(const PoseSample& pose, const Eigen::Vector3d& velocity, const Eigen::Vector3d& angular_velocity)
+{
+    Entry entry;
+    entry.timestamp = pose.timestamp;
+    Eigen::Vector3d::Map(entry.position) = pose.position;
+    Eigen::Map<Eigen::Quaterniond>(entry.orientation) = pose.orientation;
+    Eigen::Vector3d::Map(entry.velocity) = velocity;
+    Eigen::Vector3d::Map(entry.angularVelocity) = angular_velocity;
+
+    // We're the only writer, so these can't change under us.
+    const auto begin = begin_.load(std::memory_order_relaxed);
+    const auto end = end_.load(std::memory_order_relaxed);
+    if (end != begin) {
+        const auto newest = slots_[(end - 1) % Capacity].load();
+        const auto dt = osvr::util::time::duration(pose.timestamp, newest.timestamp);
+        if (dt < 0.0) {
+            return;
+        } else if (dt == 0.0) {
+            entry.index = end - 1;
+            slots_[entry.index % Capacity].store(entry);
+            return;
+        }
+    }
+
+    entry.index = end;
+    slots_[end % Capacity].store(entry);
+    end_.store(end + 1, std::memory_order_release);
+}
+
+bool PoseHistory::getPoseAt(const OSVR_TimeValue& time, PoseSample& pose) const
+{
+    // Retrying only happens if the writer gets through the whole history
+    // during one lookup, so this doesn't spin in practice.
+    for (;;) {
+        const auto result = lookUp(time, pose);
+        if (Lookup::Retry != result)
+            return Lookup::Found == result;
+    }
+}
+
+std::size_t PoseHistory::size() const
+{
+    const auto end = end_.load(std::memory_order_acquire);
+    const auto begin = std::max(begin_.load(std::memory_order_acquire), end > Capacity ? end - Capacity : 0);
+    return static_cast<std::size_t>(end - begin);
+}
+
+void PoseHistory::clear()
+{
+    // Indices keep counting up, so readers can't mistake an old entry for a
+    // new one.
+    begin_.store(end_.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+// ------------------------------------
+// Private Methods
+// ------------------------------------
+
+PoseSample PoseHistory::getPose(const Entry& entry)
+{
+    PoseSample pose;
+    pose.timestamp = entry.timestamp;
+    pose.position = Eigen::Vector3d::Map(entry.position);
+    pose.orientation = Eigen::Map<const Eigen::Quaterniond>(entry.orientation);
+    return pose;
+}
+
+bool PoseHistory::load(std::uint64_t index, Entry& entry) const
+{
+    entry = slots_[index % Capacity].load();
+    return entry.index == index;
+}
+
+PoseHistory::Lookup PoseHistory::lookUp(const OSVR_TimeValue& time, PoseSample& pose) const
+{
+    const auto end = end_.load(std::memory_order_acquire);
+    const auto begin = std::max(begin_.load(std::memory_order_acquire), end > Capacity ? end - Capacity : 0);
+    if (end == begin)
+        return Lookup::NotFound;
+
+    Entry newest;
+    if (!load(end - 1, newest))
+        return Lookup::Retry;
+
+    const auto since_newest = osvr::util::time::duration(time, newest.timestamp);
+    if (since_newest >= 0.0) {
+        if (since_newest > MaxExtrapolation)
+            return Lookup::NotFound;
+
+        // Extrapolate from the newest pose
+        const auto newest_pose = getPose(newest);
+        const Eigen::Vector3d angular_velocity = Eigen::Vector3d::Map(newest.angularVelocity);
+        const auto angle = angular_velocity.norm() * since_newest;
+
+        pose.timestamp = time;
+        pose.position = newest_pose.position + Eigen::Vector3d::Map(newest.velocity) * since_newest;
+        pose.orientation = newest_pose.orientation;
+        if (angle > 0.0) {
+            pose.orientation = (Eigen::Quaterniond(newest_pose.orientation) * Eigen::Quaterniond(Eigen::AngleAxisd(angle, angular_velocity.normalized()))).normalized();
+        }
+        return Lookup::Found;
+    }
+
+    Entry before;
+    if (!load(begin, before))
+        return Lookup::Retry;
+    if (osvr::util::time::duration(time, before.timestamp) < 0.0)
+        return Lookup::NotFound;
+
+    // Find the first pose after the time of interest. The newest one is, and
+    // the oldest one isn't.
+    auto lower = begin;
+    auto upper = end - 1;
+    Entry after = newest;
+    while (upper - lower > 1) {
+        const auto middle = lower + (upper - lower) / 2;
+        Entry entry;
+        if (!load(middle, entry))
+            return Lookup::Retry;
+        if (osvr::util::time::duration(entry.timestamp, time) > 0.0) {
+            upper = middle;
+            after = entry;
+        } else {
+            lower = middle;
+            before = entry;
+        }
+    }
+
+    const auto interval = osvr::util::time::duration(after.timestamp, before.timestamp);
+    const auto t = osvr::util::time::duration(time, before.timestamp) / interval;
+    const auto before_pose = getPose(before);
+    const auto after_pose = getPose(after);
+
+    pose.timestamp = time;
+    pose.position = before_pose.position + (after_pose.position - before_pose.position) * t;
+    pose.orientation = Eigen::Quaterniond(before_pose.orientation).slerp(t, Eigen::Quaterniond(after_pose.orientation));
+    return Lookup::Found;
+}
@@ -0,0 +1,136 @@
+/** @file
+    @brief Recent pose history with lookup by time.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PoseHistory_h_GUID_C4B0E9F2_58A1_4D7C_A36E_19F7D25B80CA
+#define INCLUDED_PoseHistory_h_GUID_C4B0E9F2_58A1_4D7C_A36E_19F7D25B80CA
+
+// Internal Includes
+#include "PoseSample.h"
+#include "SeqLock.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Keeps the most recent poses of a tracked device so the pose at an arbitrary
+ * time can be looked up.
+ *
+ * Poses are kept in a fixed-size ring in time order, so inserting is
+ * constant-time and never allocates, and looking up a time is a binary
+ * search. Times between two samples are interpolated (lerp for position,
+ * slerp for orientation); times after the newest sample are extrapolated
+ * from its velocities.
+ *
+ * There is a single writer (the tracker callback) and any number of readers.
+ * Each slot of the ring is a SeqLock, so the writer never waits for a reader
+ * and a reader never sees a half-written pose. If the writer laps a reader in
+ * the middle of a lookup, the reader starts over.
+ */
+class PoseHistory {
+public:
+    /**
+     * Number of poses kept: about two seconds of head tracking.
+     */
+    static const std::size_t Capacity = 512;
+
+    /**
+     * The furthest past the newest pose, in seconds, getPoseAt() will
+     * extrapolate.
+     */
+    static const double MaxExtrapolation;
+
+    /**
+     * Adds a pose along with its linear velocity and its angular velocity (in
+     * the pose's local frame). Poses which are not newer than the newest one
+     * are ignored, except that a pose with the same timestamp replaces it.
+     * Must only be called from one thread at a time.
+     */
+    void insert(const PoseSample& pose, const Eigen::Vector3d& velocity, const Eigen::Vector3d& angular_velocity);
+
+    /**
+     * Looks up the pose at @c time.
+     *
+     * @param time the time of interest
+     * @param[out] pose the pose at @c time, if found
+     * @return @c false if the history is empty, or @c time is before the
+     * oldest pose or too far past the newest.
+     */
+    bool getPoseAt(const OSVR_TimeValue& time, PoseSample& pose) const;
+
+    /**
+     * Returns the number of poses in the history.
+     */
+    std::size_t size() const;
+
+    /**
+     * Discards all poses. Must only be called from the thread calling
+     * insert().
+     */
+    void clear();
+
+private:
+    /// Plain arrays rather than Eigen types, since SeqLock needs a trivially
+    /// copyable value.
+    struct Entry {
+        std::uint64_t index; ///< position in the sequence of inserted poses
+        OSVR_TimeValue timestamp;
+        double position[3];
+        double orientation[4]; ///< x, y, z, w, as Eigen stores quaternions
+        double velocity[3];
+        double angularVelocity[3];
+    };
+
+    /**
+     * Returns the pose stored in an entry.
+     */
+    static PoseSample getPose(const Entry& entry);
+
+    enum class Lookup {
+        Found,
+        NotFound,
+        Retry ///< the writer overwrote an entry we needed
+    };
+
+    /**
+     * Reads the entry with the given index. Returns @c false if it has been
+     * overwritten by a newer one.
+     */
+    bool load(std::uint64_t index, Entry& entry) const;
+
+    Lookup lookUp(const OSVR_TimeValue& time, PoseSample& pose) const;
+
+    SeqLock<Entry, 2> slots_[Capacity];
+    std::atomic<std::uint64_t> begin_ { 0 }; ///< index of the oldest kept pose, before eviction
+    std::atomic<std::uint64_t> end_ { 0 };   ///< index one past the newest pose
+};
+
+#endif // INCLUDED_PoseHistory_h_GUID_C4B0E9F2_58A1_4D7C_A36E_19F7D25B80CA
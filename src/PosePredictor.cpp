@@ -0,0 +1,142 @@
+/** @file
+    @brief Extrapolates tracked device poses forward in time.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PosePredictor.h"
+#include "Logging.h"
+#include "matrix_cast.h"
+
+// Library/third-party includes
+#include <Eigen/Geometry>
+
+// Standard includes
+#include <algorithm>
+#include <cctype>
+#include <ostream>
+#include <string>
+
+void PosePredictor::setMode(Mode mode)
+{
+    mode_ = mode;
+}
+
+PosePredictor::Mode PosePredictor::getMode() const
+{
+    return mode_;
+}
+
+bool PosePredictor::enabled() const
+{
+    return Mode::Off != mode_;
+}
+
+void PosePredictor::setLookahead(double lookahead)
+{
+    lookahead_ = lookahead;
+}
+
+void PosePredictor::setMaxInterval(double max_interval)
+{
+    maxInterval_ = std::max(0.0, max_interval);
+}
+
+double PosePredictor::getTargetOffset() const
+{
+    // We'd rather predict to the next vsync, but OpenVR doesn't tell server
+    // drivers when that is (see VsyncClock), so use a fixed lookahead.
+    return lookahead_;
+}
+
+vr::DriverPose_t PosePredictor::predict(const vr::DriverPose_t& pose, double dt) const
+{
+    if (!enabled() || !pose.poseIsValid)
+        return pose;
+
+    // Don't extrapolate backwards, or so far ahead that a stale velocity
+    // sends the pose flying off.
+    dt = std::max(0.0, std::min(dt, maxInterval_));
+
+    auto predicted = pose;
+
+    const Eigen::Vector3d velocity = Eigen::Vector3d::Map(pose.vecVelocity);
+    const Eigen::Vector3d angular_velocity = Eigen::Vector3d::Map(pose.vecAngularVelocity);
+    Eigen::Vector3d translation = velocity * dt;
+    Eigen::Vector3d rotation_vector = angular_velocity * dt;
+
+    if (Mode::Acceleration == mode_) {
+        const Eigen::Vector3d acceleration = Eigen::Vector3d::Map(pose.vecAcceleration);
+        const Eigen::Vector3d angular_acceleration = Eigen::Vector3d::Map(pose.vecAngularAcceleration);
+        translation += 0.5 * acceleration * dt * dt;
+        rotation_vector += 0.5 * angular_acceleration * dt * dt;
+        Eigen::Vector3d::Map(predicted.vecVelocity) += acceleration * dt;
+        Eigen::Vector3d::Map(predicted.vecAngularVelocity) += angular_acceleration * dt;
+    }
+
+    Eigen::Vector3d::Map(predicted.vecPosition) += translation;
+
+    const auto angle = rotation_vector.norm();
+    if (angle > 0.0) {
+        const Eigen::Quaterniond rotation = map(pose.qRotation);
+        const Eigen::Quaterniond increment(Eigen::AngleAxisd(angle, rotation_vector / angle));
+        map(predicted.qRotation) = (rotation * increment).normalized();
+    }
+
+    predicted.poseTimeOffset -= dt;
+
+    return predicted;
+}
+
+PosePredictor::Mode parsePredictionMode(const std::string& str)
+{
+    auto mode = str;
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if ("off" == mode) {
+        return PosePredictor::Mode::Off;
+    } else if ("velocity" == mode) {
+        return PosePredictor::Mode::Velocity;
+    } else if ("acceleration" == mode) {
+        return PosePredictor::Mode::Acceleration;
+    } else {
+        OSVR_LOG(err) << "The string [" + str + "] could not be parsed as a prediction mode. Use one of: off, velocity, acceleration.";
+        return PosePredictor::Mode::Off;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, PosePredictor::Mode mode)
+{
+    switch (mode) {
+    case PosePredictor::Mode::Off:
+        os << "off";
+        break;
+    case PosePredictor::Mode::Velocity:
+        os << "velocity";
+        break;
+    case PosePredictor::Mode::Acceleration:
+        os << "acceleration";
+        break;
+    }
+    return os;
+}
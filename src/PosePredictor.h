@@ -0,0 +1,96 @@
+/** @file
+    @brief Extrapolates tracked device poses forward in time.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PosePredictor_h_GUID_5E1B7A93_2C4D_4F86_9A0E_7D3F8B61C2E4
+#define INCLUDED_PosePredictor_h_GUID_5E1B7A93_2C4D_4F86_9A0E_7D3F8B61C2E4
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <iosfwd>
+#include <string>
+
+/**
+ * Extrapolates a pose to a target time from the velocities it carries.
+ *
+ * The target time is a fixed lookahead past the time of the prediction.
+ * Predicted poses have their poseTimeOffset adjusted so they still describe
+ * the time they were predicted for.
+ */
+class PosePredictor {
+public:
+    enum class Mode {
+        Off,         ///< report poses as they were received
+        Velocity,    ///< constant linear and angular velocity
+        Acceleration ///< constant linear and angular acceleration
+    };
+
+    void setMode(Mode mode);
+    Mode getMode() const;
+
+    /**
+     * Returns @c true if poses should be predicted.
+     */
+    bool enabled() const;
+
+    /**
+     * Sets how far past now to predict, in seconds.
+     */
+    void setLookahead(double lookahead);
+
+    /**
+     * Sets the longest interval, in seconds, a pose will be extrapolated over.
+     */
+    void setMaxInterval(double max_interval);
+
+    /**
+     * Returns the time from now until the prediction target, in seconds.
+     */
+    double getTargetOffset() const;
+
+    /**
+     * Returns @c pose extrapolated @c dt seconds into the future. The pose's
+     * angular velocity and acceleration are expected in its local frame.
+     */
+    vr::DriverPose_t predict(const vr::DriverPose_t& pose, double dt) const;
+
+private:
+    Mode mode_ = Mode::Off;
+    double lookahead_ = 0.0;
+    double maxInterval_ = 0.05;
+};
+
+/**
+ * Parses a string into a prediction mode.
+ */
+PosePredictor::Mode parsePredictionMode(const std::string& str);
+
+std::ostream& operator<<(std::ostream& os, PosePredictor::Mode mode);
+
+#endif // INCLUDED_PosePredictor_h_GUID_5E1B7A93_2C4D_4F86_9A0E_7D3F8B61C2E4
@@ -0,0 +1,53 @@
+/** @file
+    @brief A timestamped pose.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PoseSample_h_GUID_71C9E3A4_0D5B_4B28_93F6_AE24C8D71B05
+#define INCLUDED_PoseSample_h_GUID_71C9E3A4_0D5B_4B28_93F6_AE24C8D71B05
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+// - none
+
+/**
+ * A timestamped pose.
+ *
+ * The Eigen members are unaligned so samples can live in ordinary
+ * heap-allocated objects and containers.
+ */
+struct PoseSample {
+    OSVR_TimeValue timestamp;
+    Eigen::Matrix<double, 3, 1, Eigen::DontAlign> position;
+    Eigen::Quaternion<double, Eigen::DontAlign> orientation;
+};
+
+#endif // INCLUDED_PoseSample_h_GUID_71C9E3A4_0D5B_4B28_93F6_AE24C8D71B05
@@ -0,0 +1,100 @@
+/** @file
+    @brief Bridges position between low-rate tracker reports.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PositionFilter.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+
+#include <osvr/Util/TimeValue.h>
+
+// Standard includes
+#include <algorithm>
+
+void PositionFilter::setGains(double alpha, double beta)
+{
+    alpha_ = std::max(0.0, std::min(alpha, 1.0));
+    beta_ = std::max(0.0, std::min(beta, 1.0));
+}
+
+void PositionFilter::setMaxExtrapolation(double max_extrapolation)
+{
+    maxExtrapolation_ = max_extrapolation;
+}
+
+void PositionFilter::update(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position)
+{
+    const auto dt = valid_ ? osvr::util::time::duration(timestamp, timestamp_) : 0.0;
+    if (!valid_ || dt > maxExtrapolation_) {
+        // First measurement, or the tracker was lost for a while: start over.
+        valid_ = true;
+        timestamp_ = timestamp;
+        position_ = position;
+        velocity_ = Eigen::Vector3d::Zero();
+        return;
+    }
+
+    if (dt <= 0.0) {
+        // Out-of-order or duplicate measurement
+        return;
+    }
+
+    const Eigen::Vector3d predicted = position_ + velocity_ * dt;
+    const Eigen::Vector3d residual = position - predicted;
+
+    timestamp_ = timestamp;
+    position_ = predicted + alpha_ * residual;
+    velocity_ += (beta_ / dt) * residual;
+}
+
+bool PositionFilter::valid() const
+{
+    return valid_;
+}
+
+Eigen::Vector3d PositionFilter::getPosition(const OSVR_TimeValue& time) const
+{
+    if (!valid_)
+        return Eigen::Vector3d::Zero();
+
+    const auto dt = std::max(0.0, std::min(osvr::util::time::duration(time, timestamp_), maxExtrapolation_));
+    return position_ + velocity_ * dt;
+}
+
+Eigen::Vector3d PositionFilter::getVelocity(const OSVR_TimeValue& time) const
+{
+    if (!valid_ || osvr::util::time::duration(time, timestamp_) > maxExtrapolation_)
+        return Eigen::Vector3d::Zero();
+
+    return velocity_;
+}
+
+void PositionFilter::reset()
+{
+    valid_ = false;
+    position_ = Eigen::Vector3d::Zero();
+    velocity_ = Eigen::Vector3d::Zero();
+}
@@ -0,0 +1,102 @@
+/** @file
+    @brief Bridges position between low-rate tracker reports.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PositionFilter_h_GUID_8B2E6D14_F37A_4C59_A0D8_6C1E93B7F245
+#define INCLUDED_PositionFilter_h_GUID_8B2E6D14_F37A_4C59_A0D8_6C1E93B7F245
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+#include <Eigen/Core>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+// - none
+
+/**
+ * Estimates position at arbitrary times from a low-rate position stream.
+ *
+ * This is an alpha-beta filter: a lightweight complementary filter which
+ * blends each measurement with the position predicted from the previous
+ * state, and uses the residual to correct a velocity estimate. Between
+ * measurements the position is extrapolated from that velocity, up to a
+ * limit so a lost tracker doesn't send the position flying off.
+ */
+class PositionFilter {
+public:
+    /**
+     * Sets the filter gains. @c alpha is the weight given to a new position
+     * measurement and @c beta the weight given to the velocity it implies;
+     * both are between 0 and 1.
+     */
+    void setGains(double alpha, double beta);
+
+    /**
+     * Sets the longest time, in seconds, the position is extrapolated past the
+     * last measurement. Measurements further apart than this restart the
+     * filter.
+     */
+    void setMaxExtrapolation(double max_extrapolation);
+
+    /**
+     * Adds a position measurement.
+     */
+    void update(const OSVR_TimeValue& timestamp, const Eigen::Vector3d& position);
+
+    /**
+     * Returns @c true once a measurement has been added.
+     */
+    bool valid() const;
+
+    /**
+     * Returns the estimated position at @c time.
+     */
+    Eigen::Vector3d getPosition(const OSVR_TimeValue& time) const;
+
+    /**
+     * Returns the estimated velocity at @c time: zero once @c time is past
+     * the extrapolation limit, where getPosition() stops moving.
+     */
+    Eigen::Vector3d getVelocity(const OSVR_TimeValue& time) const;
+
+    /**
+     * Forgets all measurements.
+     */
+    void reset();
+
+private:
+    double alpha_ = 0.8;
+    double beta_ = 0.4;
+    double maxExtrapolation_ = 0.1;
+
+    bool valid_ = false;
+    OSVR_TimeValue timestamp_;
+    Eigen::Vector3d position_ = Eigen::Vector3d::Zero();
+    Eigen::Vector3d velocity_ = Eigen::Vector3d::Zero();
+};
+
+#endif // INCLUDED_PositionFilter_h_GUID_8B2E6D14_F37A_4C59_A0D8_6C1E93B7F245
@@ -0,0 +1,51 @@
+/** @file
+    @brief Reports how much memory the process is using.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_ProcessMemory_h_GUID_7A4E2C19_5D83_4F6B_B1E7_93C0A6D5F248
+#define INCLUDED_ProcessMemory_h_GUID_7A4E2C19_5D83_4F6B_B1E7_93C0A6D5F248
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cstddef>
+
+/**
+ * Returns the resident set size (the working set on Windows) of this process
+ * in bytes, or 0 if it can't be determined.
+ */
+std::size_t getResidentMemory();
+
+/**
+ * Asks the heap to return freed memory to the operating system, where the
+ * platform supports it. Freeing memory alone usually leaves it mapped, so
+ * call this before measuring how much a release saved.
+ */
+void trimHeap();
+
+#endif // INCLUDED_ProcessMemory_h_GUID_7A4E2C19_5D83_4F6B_B1E7_93C0A6D5F248
@@ -0,0 +1,131 @@
+/** @file
+    @brief Fixed-capacity ring buffer.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_RingBuffer_h_GUID_3F8C2D71_9B4E_4A6D_8E15_C04A7B2E9D63
+#define INCLUDED_RingBuffer_h_GUID_3F8C2D71_9B4E_4A6D_8E15_C04A7B2E9D63
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+/**
+ * A fixed-capacity FIFO which never allocates. Pushing onto a full buffer
+ * overwrites the oldest element.
+ *
+ * Elements are indexed from the oldest (0) to the newest (size() - 1).
+ */
+template <typename T, std::size_t Capacity>
+class RingBuffer {
+public:
+    static_assert(Capacity > 0, "RingBuffer needs a capacity of at least one.");
+
+    /**
+     * Appends a value, dropping the oldest one if the buffer is full.
+     */
+    void push_back(const T& value)
+    {
+        elements_[(begin_ + size_) % Capacity] = value;
+        if (size_ < Capacity) {
+            ++size_;
+        } else {
+            begin_ = (begin_ + 1) % Capacity;
+        }
+    }
+
+    /**
+     * Removes all elements.
+     */
+    void clear()
+    {
+        begin_ = 0;
+        size_ = 0;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return 0 == size_;
+    }
+
+    bool full() const
+    {
+        return Capacity == size_;
+    }
+
+    static std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+    T& operator[](std::size_t i)
+    {
+        assert(i < size_);
+        return elements_[(begin_ + i) % Capacity];
+    }
+
+    const T& operator[](std::size_t i) const
+    {
+        assert(i < size_);
+        return elements_[(begin_ + i) % Capacity];
+    }
+
+    T& front()
+    {
+        return (*this)[0];
+    }
+
+    const T& front() const
+    {
+        return (*this)[0];
+    }
+
+    T& back()
+    {
+        return (*this)[size_ - 1];
+    }
+
+    const T& back() const
+    {
+        return (*this)[size_ - 1];
+    }
+
+private:
+    std::array<T, Capacity> elements_;
+    std::size_t begin_ = 0;
+    std::size_t size_ = 0;
+};
+
+#endif // INCLUDED_RingBuffer_h_GUID_3F8C2D71_9B4E_4A6D_8E15_C04A7B2E9D63
@@ -0,0 +1,160 @@
+/** @file
+    @brief Single-writer, multiple-reader sequence lock.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SeqLock_h_GUID_0C7E4D92_6B1A_4A38_8F5D_E2B9317C6A05
+#define INCLUDED_SeqLock_h_GUID_0C7E4D92_6B1A_4A38_8F5D_E2B9317C6A05
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Publishes a trivially-copyable value from one writer thread to any number
+ * of reader threads without locks.
+ *
+ * The value is kept in a small ring of sequence-numbered slots. The writer
+ * always fills the slot after the published one and then publishes it, so it
+ * never blocks and a reader only has to retry if the writer manages to wrap
+ * all the way around the ring during a single read. Readers never observe a
+ * partially-written (torn) value.
+ *
+ * The payload is copied word-by-word through relaxed atomics so concurrent
+ * reads and writes are well-defined.
+ *
+ * @tparam T a trivially-copyable type
+ * @tparam Slots number of slots in the ring (at least 2)
+ */
+template <typename T, std::size_t Slots = 4>
+class SeqLock {
+public:
+    static_assert(Slots >= 2, "SeqLock needs at least two slots.");
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies its value with memcpy, so it must be trivially copyable.");
+
+    SeqLock();
+    explicit SeqLock(const T& value);
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /**
+     * Publishes a new value. Must only be called from one thread at a time.
+     */
+    void store(const T& value);
+
+    /**
+     * Returns the most recently published value. May be called from any
+     * number of threads.
+     */
+    T load() const;
+
+private:
+    using Word = std::uint64_t;
+    static const std::size_t WordCount = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    struct Slot {
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<Word> words[WordCount];
+    };
+
+    Slot slots_[Slots];
+    std::atomic<std::size_t> current_;
+};
+
+template <typename T, std::size_t Slots>
+inline SeqLock<T, Slots>::SeqLock() : SeqLock(T())
+{
+    // do nothing
+}
+
+template <typename T, std::size_t Slots>
+inline SeqLock<T, Slots>::SeqLock(const T& value)
+{
+    for (auto& slot : slots_) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    current_.store(0, std::memory_order_relaxed);
+    store(value);
+}
+
+template <typename T, std::size_t Slots>
+inline void SeqLock<T, Slots>::store(const T& value)
+{
+    Word buffer[WordCount] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+
+    const auto index = (current_.load(std::memory_order_relaxed) + 1) % Slots;
+    auto& slot = slots_[index];
+
+    // An odd sequence number marks the slot as being written.
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < WordCount; ++i) {
+        slot.words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    current_.store(index, std::memory_order_release);
+}
+
+template <typename T, std::size_t Slots>
+inline T SeqLock<T, Slots>::load() const
+{
+    Word buffer[WordCount];
+    for (;;) {
+        const auto& slot = slots_[current_.load(std::memory_order_acquire)];
+
+        const auto before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            // The writer has lapped us and is rewriting this slot.
+            continue;
+        }
+
+        for (std::size_t i = 0; i < WordCount; ++i) {
+            buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto after = slot.sequence.load(std::memory_order_relaxed);
+        if (before == after)
+            break;
+    }
+
+    T value;
+    std::memcpy(&value, buffer, sizeof(T));
+    return value;
+}
+
+#endif // INCLUDED_SeqLock_h_GUID_0C7E4D92_6B1A_4A38_8F5D_E2B9317C6A05
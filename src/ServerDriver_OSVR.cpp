@@ -43,24 +43,7 @@
 #include <cstring>                  // for std::strcmp
 #include <string>                   // for std::string
 #include <chrono>
-#include <thread>
-#include <atomic>
-
-namespace {
-
-static std::thread client_update_thread;
-static std::atomic<bool> client_update_thread_quit;
-static std::atomic<int> client_update_thread_ms_wait;
-static void client_update_thread_work(osvr::clientkit::ClientContext& ctx)
-{
-    while (!client_update_thread_quit.load()) {
-        ctx.update();
-        std::this_thread::sleep_for(std::chrono::milliseconds(client_update_thread_ms_wait.load()));
-    }
-    client_update_thread_quit = false;
-}
-
-} // anonymous namespace
+#include <utility>                  // for std::move
 
 vr::EVRInitError ServerDriver_OSVR::Init(vr::IVRDriverContext* driver_context)
 {
@@ -81,28 +64,63 @@ vr::EVRInitError ServerDriver_OSVR::Init(vr::IVRDriverContext* driver_context)
     activeWaitPeriod_ = settings_->getSetting<int>("activeWaitPeriod", 1);
     OSVR_LOG(debug) << "Standby wait period is " << standbyWaitPeriod_ << " ms.";
     OSVR_LOG(debug) << "Active wait period is " << activeWaitPeriod_ << " ms.";
+    const auto update_mode = parseClientUpdateMode(settings_->getSetting<std::string>("clientUpdateMode", "fixed"));
+    const auto event_slack = settings_->getSetting<float>("eventSlack", 0.25f);
+    const auto event_max_wait_period = settings_->getSetting<int>("eventMaxWaitPeriod", 10);
+    const auto vsync_update_offset = settings_->getSetting<float>("vsyncUpdateOffset", 6.0f);
+    const auto vsync_last_update_offset = settings_->getSetting<float>("vsyncLastUpdateOffset", 3.0f);
+    OSVR_LOG(debug) << "Client update mode is " << update_mode << ".";
+    const auto coalesce_pose_reports = settings_->getSetting<bool>("coalescePoseReports", false);
+    OSVR_LOG(debug) << (coalesce_pose_reports ? "Coalescing" : "Not coalescing") << " pose reports.";
 
     context_ = std::make_unique<osvr::clientkit::ClientContext>("org.osvr.SteamVR");
 
-    trackedDevices_.emplace_back(std::make_unique<OSVRTrackedHMD>(*(context_.get())));
+    auto hmd = std::make_unique<OSVRTrackedHMD>(*(context_.get()));
+    const auto* hmd_ptr = hmd.get();
+    trackedDevices_.emplace_back(std::move(hmd));
     trackedDevices_.emplace_back(std::make_unique<OSVRTrackingReference>(*(context_.get())));
 
     for (auto& tracked_device : trackedDevices_) {
+        tracked_device->setCoalescePoses(coalesce_pose_reports);
         vr::VRServerDriverHost()->TrackedDeviceAdded(tracked_device->getId(), tracked_device->getDeviceClass(), tracked_device.get());
     }
 
-    client_update_thread_quit.store(false);
-    client_update_thread_ms_wait.store(activeWaitPeriod_);
-    client_update_thread = std::thread(client_update_thread_work, std::ref(*context_));
+    // Schedule client updates around the arrival of head tracker reports or
+    // the HMD's refresh cycle
+    using std::chrono::milliseconds;
+    using std::chrono::microseconds;
+    clientUpdateLoop_ = std::make_unique<ClientUpdateLoop>(*context_);
+    clientUpdateLoop_->setMode(update_mode);
+    clientUpdateLoop_->setReportCounter([hmd_ptr] { return hmd_ptr->getReportCount(); });
+    if (coalesce_pose_reports) {
+        // Send each device's newest pose once per update()
+        clientUpdateLoop_->setAfterUpdate([this] {
+            for (auto& tracked_device : trackedDevices_) {
+                tracked_device->flushPose();
+            }
+        });
+    }
+    clientUpdateLoop_->setVsyncClock(&hmd_ptr->getVsyncClock());
+    clientUpdateLoop_->setActiveWaitPeriod(milliseconds(activeWaitPeriod_));
+    clientUpdateLoop_->setStandbyWaitPeriod(milliseconds(standbyWaitPeriod_));
+    clientUpdateLoop_->setEventSlack(microseconds(static_cast<int>(event_slack * 1000.0f)));
+    clientUpdateLoop_->setEventMaxWaitPeriod(milliseconds(event_max_wait_period));
+    clientUpdateLoop_->setVsyncUpdateOffset(microseconds(static_cast<int>(vsync_update_offset * 1000.0f)));
+    clientUpdateLoop_->setVsyncLastUpdateOffset(microseconds(static_cast<int>(vsync_last_update_offset * 1000.0f)));
+    clientUpdateLoop_->start();
 
     return vr::VRInitError_None;
 }
 
 void ServerDriver_OSVR::Cleanup()
 {
-    client_update_thread_quit.store(true);
-    if (client_update_thread.joinable()) {
-        client_update_thread.join();
+    if (clientUpdateLoop_) {
+        clientUpdateLoop_->stop();
+        clientUpdateLoop_.reset();
+    }
+
+    for (const auto& tracked_device : trackedDevices_) {
+        OSVR_LOG(info) << tracked_device->getName() << " received " << tracked_device->getReportCount() << " pose reports, of which " << tracked_device->getCoalescedCount() << " were coalesced.";
     }
 
     trackedDevices_.clear();
@@ -128,12 +146,14 @@ bool ServerDriver_OSVR::ShouldBlockStandbyMode()
 void ServerDriver_OSVR::EnterStandby()
 {
     OSVR_LOG(debug) << "Entering standby mode...";
-    client_update_thread_ms_wait.store(standbyWaitPeriod_);
+    if (clientUpdateLoop_)
+        clientUpdateLoop_->setStandby(true);
 }
 
 void ServerDriver_OSVR::LeaveStandby()
 {
     OSVR_LOG(debug) << "Leaving standby mode...";
-    client_update_thread_ms_wait.store(activeWaitPeriod_);
+    if (clientUpdateLoop_)
+        clientUpdateLoop_->setStandby(false);
 }
 
@@ -26,6 +26,7 @@
 #define INCLUDED_ServerDriver_OSVR_h_GUID_136B1359_C29D_4198_9CA0_1C223CC83B84
 
 // Internal Includes
+#include "ClientUpdateLoop.h"           // for ClientUpdateLoop
 #include "OSVRTrackedDevice.h"          // for OSVRTrackedDevice
 #include "osvr_compiler_detection.h"    // for OSVR_OVERRIDE
 #include "Settings.h"                   // for Settings
@@ -111,6 +112,7 @@ private:
     std::vector<std::unique_ptr<OSVRTrackedDevice>> trackedDevices_;
     std::unique_ptr<osvr::clientkit::ClientContext> context_;
     std::unique_ptr<Settings> settings_;
+    std::unique_ptr<ClientUpdateLoop> clientUpdateLoop_;
     int standbyWaitPeriod_ = 100; // ms
     int activeWaitPeriod_ = 1; // ms
 };
@@ -0,0 +1,75 @@
+/** @file
+    @brief Predicts display vertical sync times.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "VsyncClock.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <chrono>
+
+void VsyncClock::setRefreshRate(double refresh_rate)
+{
+    if (refresh_rate <= 0.0)
+        return;
+
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / refresh_rate));
+
+    // We have no way to observe a real vsync, so anchor to now. The phase of
+    // the predicted vsyncs is therefore arbitrary.
+    if (0 == anchor_.load()) {
+        anchor_.store(clock::now().time_since_epoch().count());
+    }
+    period_.store(period.count());
+}
+
+bool VsyncClock::valid() const
+{
+    return period_.load() > 0;
+}
+
+VsyncClock::clock::duration VsyncClock::getPeriod() const
+{
+    return clock::duration(period_.load());
+}
+
+VsyncClock::clock::time_point VsyncClock::nextVsync(clock::time_point time) const
+{
+    const auto period = period_.load();
+    if (period <= 0)
+        return time;
+
+    const auto anchor = anchor_.load();
+    const auto since_anchor = time.time_since_epoch().count() - anchor;
+
+    // Floor division so times before the anchor work too
+    auto frames = since_anchor / period;
+    if (since_anchor < 0 && frames * period != since_anchor)
+        --frames;
+
+    return clock::time_point(clock::duration(anchor + (frames + 1) * period));
+}
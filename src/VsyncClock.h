@@ -0,0 +1,80 @@
+/** @file
+    @brief Predicts display vertical sync times.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_VsyncClock_h_GUID_9D3A6C21_4E8B_4F0A_B7C5_2A1E6F9D0B34
+#define INCLUDED_VsyncClock_h_GUID_9D3A6C21_4E8B_4F0A_B7C5_2A1E6F9D0B34
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Predicts vertical sync times from the display refresh rate.
+ *
+ * OpenVR doesn't report vsync times to server drivers, so the clock is
+ * anchored to the time the refresh rate was first set. The predicted vsyncs
+ * have the right period but an arbitrary phase: they are NOT locked to the
+ * display's actual vsync.
+ *
+ * All methods are thread-safe.
+ */
+class VsyncClock {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * Sets the display refresh rate in Hz. Non-positive values are ignored.
+     */
+    void setRefreshRate(double refresh_rate);
+
+    /**
+     * Returns @c true once a refresh rate has been set.
+     */
+    bool valid() const;
+
+    /**
+     * Returns the refresh period, or zero if the refresh rate is unknown.
+     */
+    clock::duration getPeriod() const;
+
+    /**
+     * Returns the first predicted vsync strictly after @c time. Returns
+     * @c time if the refresh rate is unknown.
+     */
+    clock::time_point nextVsync(clock::time_point time) const;
+
+private:
+    std::atomic<clock::rep> period_ { 0 };
+    std::atomic<clock::rep> anchor_ { 0 };
+};
+
+#endif // INCLUDED_VsyncClock_h_GUID_9D3A6C21_4E8B_4F0A_B7C5_2A1E6F9D0B34
@@ -0,0 +1,249 @@
+/** @file
+    @brief Sweeps distortion mesh densities to trade accuracy for cost.
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "Distortion.h"
+#include "DistortionMesh.h"
+#include "ProcessMemory.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+#include <osvr/RenderKit/DistortionParameters.h>
+#include <osvr/RenderKit/osvr_display_configuration.h>
+
+// Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct ErrorStatistics {
+    double max = 0.0;
+    double rms = 0.0;
+};
+
+double getMilliseconds(clock_type::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+double distance(const float (&a)[2], const float (&b)[2])
+{
+    return std::hypot(static_cast<double>(a[0]) - b[0], static_cast<double>(a[1]) - b[1]);
+}
+
+/**
+ * Measures the error of @c distortion against @c reference at the center of
+ * each cell of a @c grid by @c grid grid, over all three colors.
+ */
+ErrorStatistics getErrorStatistics(const DistortionFunction& distortion, const DistortionFunction& reference, std::size_t grid)
+{
+    ErrorStatistics statistics;
+    double sum_squares = 0.0;
+    for (std::size_t j = 0; j < grid; ++j) {
+        const auto v = (static_cast<float>(j) + 0.5f) / static_cast<float>(grid);
+        for (std::size_t i = 0; i < grid; ++i) {
+            const auto u = (static_cast<float>(i) + 0.5f) / static_cast<float>(grid);
+            const auto expected = reference(u, v);
+            const auto actual = distortion(u, v);
+            for (const auto error : { distance(expected.rfRed, actual.rfRed), distance(expected.rfGreen, actual.rfGreen), distance(expected.rfBlue, actual.rfBlue) }) {
+                statistics.max = std::max(statistics.max, error);
+                sum_squares += error * error;
+            }
+        }
+    }
+    statistics.rms = std::sqrt(sum_squares / static_cast<double>(3 * grid * grid));
+    return statistics;
+}
+
+/**
+ * Parses a comma-separated list of triangle counts. Returns an empty list if
+ * any of them isn't a number of at least 2.
+ */
+std::vector<std::size_t> parseTriangleCounts(const std::string& str)
+{
+    std::vector<std::size_t> counts;
+    std::istringstream stream(str);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char* end = nullptr;
+        const auto count = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || count < 2)
+            return {};
+        counts.push_back(static_cast<std::size_t>(count));
+    }
+    return counts;
+}
+
+int usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <display descriptor> [--eye <0 or 1>] [--triangles <count,count,...>] [--grid <size >= 2>] [--threads <count>]\n"
+              << "\n"
+              << "Reports the cost and accuracy of the distortion modes, measured against the mesh\n"
+              << "interpolators on a dense grid: first the mesh interpolators and the triangle mesh,\n"
+              << "which come straight from the point samples, then a lookup table at each triangle\n"
+              << "count. Pin the chosen count with the driver_osvr distortionTriangles setting. It\n"
+              << "only applies to distortionMode \"table\"; the other modes ignore it." << std::endl;
+    return EXIT_FAILURE;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    std::string descriptor_path;
+    std::size_t eye = 0;
+    std::vector<std::size_t> triangle_counts = { 2 * 8 * 8, 2 * 16 * 16, 2 * 32 * 32, 2 * 64 * 64, 200 * 64, 2 * 128 * 128, 2 * 256 * 256 };
+    std::size_t grid = 512; // denser than any of the tables
+    std::size_t threads = 0;
+    for (auto i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ("--eye" == arg && i + 1 < argc) {
+            eye = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if ("--triangles" == arg && i + 1 < argc) {
+            triangle_counts = parseTriangleCounts(argv[++i]);
+        } else if ("--grid" == arg && i + 1 < argc) {
+            grid = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if ("--threads" == arg && i + 1 < argc) {
+            threads = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (!arg.empty() && '-' != arg[0] && descriptor_path.empty()) {
+            descriptor_path = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (descriptor_path.empty() || eye > 1 || triangle_counts.empty() || grid < 2) {
+        return usage(argv[0]);
+    }
+    threads = getDistortionBuildThreads(threads);
+
+    // Build the distortion parameters the way
+    // OSVRTrackedHMD::configureDistortionParameters() does.
+    std::ifstream file(descriptor_path);
+    if (!file) {
+        std::cerr << "Could not open display descriptor [" << descriptor_path << "]." << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string description { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    std::vector<osvr::renderkit::DistortionParameters> parameters;
+    try {
+        OSVRDisplayConfiguration configuration(description);
+        for (std::size_t i = 0; i < configuration.getEyes().size(); ++i) {
+            parameters.push_back(osvr::renderkit::DistortionParameters { configuration, i });
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Could not parse display descriptor [" << descriptor_path << "]: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (eye >= parameters.size()) {
+        std::cerr << "Display descriptor [" << descriptor_path << "] has no eye " << eye << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The interpolators come straight from the point samples; the triangle
+    // count doesn't affect them.
+    const auto memory_before = getResidentMemory();
+    const auto start = clock_type::now();
+    auto all_interpolators = makeMeshInterpolators(parameters, threads);
+    const auto interpolator_ms = getMilliseconds(start);
+    const auto memory_after = getResidentMemory();
+    const auto interpolator_bytes = (memory_after > memory_before) ? memory_after - memory_before : 0;
+    const auto& interpolators = all_interpolators[eye];
+    if (interpolators.empty()) {
+        std::cerr << "Display descriptor [" << descriptor_path << "] doesn't describe the distortion with point samples." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto reference = [&](float u, float v) { return computeMeshDistortion(eye, u, v, parameters[eye], 1.0f, interpolators); };
+    float checksum = 0.0f;
+    const auto reference_ns = timeDistortion(reference, 256, checksum);
+    std::cout << "Display descriptor: " << descriptor_path << ", eye " << eye << "\n"
+              << "Errors are in texture coordinates, measured at " << grid << "x" << grid << " points.\n"
+              << "Build times and sizes are for all " << parameters.size() << " eyes, using " << threads << " threads.\n\n";
+
+    // The modes that don't depend on the triangle count. The interpolators'
+    // size is the growth of the process, since they don't report it.
+    const auto mesh_start = clock_type::now();
+    const auto all_meshes = makeDistortionMeshes(parameters, threads);
+    const auto mesh_ms = getMilliseconds(mesh_start);
+    std::size_t mesh_bytes = 0;
+    for (const auto& meshes : all_meshes) {
+        for (const auto& mesh : meshes) {
+            mesh_bytes += mesh.getMemoryUsage();
+        }
+    }
+
+    std::cout << std::setw(14) << "mode" << std::setw(12) << "build ms" << std::setw(12) << "bytes" << std::setw(12) << "ns/query" << std::setw(14) << "max error" << std::setw(14) << "rms error" << "\n";
+    std::cout << std::setw(14) << "interpolator" << std::setw(12) << std::fixed << std::setprecision(2) << interpolator_ms << std::setw(12) << interpolator_bytes
+              << std::setw(12) << reference_ns << std::setw(14) << "-" << std::setw(14) << "-" << "\n";
+    std::cout.unsetf(std::ios_base::floatfield);
+    if (eye < all_meshes.size() && !all_meshes[eye].empty()) {
+        const auto& meshes = all_meshes[eye];
+        const auto mesh = [&meshes](float u, float v) { return interpolateDistortion(u, v, meshes); };
+        const auto mesh_ns = timeDistortion(mesh, 256, checksum);
+        const auto errors = getErrorStatistics(mesh, reference, grid);
+        std::cout << std::setw(14) << "mesh" << std::setw(12) << std::fixed << std::setprecision(2) << mesh_ms << std::setw(12) << mesh_bytes
+                  << std::setw(12) << mesh_ns << std::setw(14) << std::scientific << std::setprecision(3) << errors.max << std::setw(14) << errors.rms << "\n";
+        std::cout.unsetf(std::ios_base::floatfield);
+    } else {
+        std::cout << std::setw(14) << "mesh" << "  could not triangulate the point samples\n";
+    }
+
+    std::cout << "\nLookup tables (distortionMode \"table\", the only mode distortionTriangles affects):\n";
+    std::cout << std::setw(10) << "triangles" << std::setw(12) << "resolution" << std::setw(12) << "build ms" << std::setw(12) << "bytes"
+              << std::setw(12) << "ns/query" << std::setw(14) << "max error" << std::setw(14) << "rms error" << "\n";
+    for (const auto triangles : triangle_counts) {
+        const auto resolution = getDistortionTableResolution(static_cast<float>(triangles));
+        DistortionLookupTable table;
+        const auto table_start = clock_type::now();
+        table.build(resolution, resolution, makeBatchFunction(reference), threads);
+        const auto build_ms = getMilliseconds(table_start);
+
+        const auto lookup = [&table](float u, float v) { return table.lookup(u, v); };
+        const auto lookup_ns = timeDistortion(lookup, 256, checksum);
+        const auto errors = getErrorStatistics(lookup, reference, grid);
+        const auto bytes = table.getValues().size() * sizeof(float);
+
+        std::cout << std::setw(10) << triangles << std::setw(12) << resolution << std::setw(12) << std::fixed << std::setprecision(2) << build_ms << std::setw(12) << bytes
+                  << std::setw(12) << lookup_ns << std::setw(14) << std::scientific << std::setprecision(3) << errors.max << std::setw(14) << errors.rms << "\n";
+        std::cout.unsetf(std::ios_base::floatfield);
+    }
+    std::cout << "\n(checksum " << checksum << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
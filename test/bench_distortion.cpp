@@ -0,0 +1,472 @@
+/** @file
+    @brief Benchmark for the ComputeDistortion() implementations
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "Distortion.h"
+#include "DistortionKernel.h"
+#include "DistortionMesh.h"
+#include "DistortionPolynomial.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+#include <json/json.h>
+#include <osvr/RenderKit/DistortionParameters.h>
+#include <osvr/RenderKit/UnstructuredMeshInterpolator.h>
+#include <osvr/RenderKit/osvr_display_configuration.h>
+
+// Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * Per-call latency is measured over blocks of this many consecutive calls so
+ * the cost of reading the clock doesn't swamp the calls themselves.
+ */
+const std::size_t LatencyBlock = 8;
+
+/**
+ * A set of distortion parameters for both eyes to benchmark.
+ */
+struct Descriptor {
+    std::string name;
+    std::vector<osvr::renderkit::DistortionParameters> parameters;
+};
+
+/**
+ * Builds RGB point-sample distortion parameters for a simple radial
+ * distortion with a little chromatic aberration, sampled on a regular
+ * @c samples by @c samples grid. 33 is similar in density to an HDK display
+ * descriptor.
+ */
+osvr::renderkit::DistortionParameters makeSyntheticParameters(std::size_t samples)
+{
+    static const double k1[] = { 0.22, 0.24, 0.26 }; // red, green, blue
+
+    osvr::renderkit::DistortionParameters parameters;
+    parameters.m_type = osvr::renderkit::DistortionParameters::rgb_point_samples;
+    parameters.m_desiredTriangles = 200 * 64;
+    parameters.m_rgbPointSamples.resize(3);
+    for (std::size_t color = 0; color < 3; ++color) {
+        parameters.m_rgbPointSamples[color].resize(2);
+        for (std::size_t eye = 0; eye < 2; ++eye) {
+            auto& mesh = parameters.m_rgbPointSamples[color][eye];
+            for (std::size_t j = 0; j < samples; ++j) {
+                for (std::size_t i = 0; i < samples; ++i) {
+                    const auto x = static_cast<double>(i) / static_cast<double>(samples - 1);
+                    const auto y = static_cast<double>(j) / static_cast<double>(samples - 1);
+                    const auto dx = x - 0.5;
+                    const auto dy = y - 0.5;
+                    const auto scale = 1.0 + k1[color] * (dx * dx + dy * dy);
+                    mesh.push_back({ { { { x, y } }, { { 0.5 + dx * scale, 0.5 + dy * scale } } } });
+                }
+            }
+        }
+    }
+
+    return parameters;
+}
+
+Descriptor makeSyntheticDescriptor(std::size_t samples)
+{
+    const auto parameters = makeSyntheticParameters(samples);
+    return { "synthetic " + std::to_string(samples) + "x" + std::to_string(samples), { parameters, parameters } };
+}
+
+/**
+ * Loads a display descriptor and builds the distortion parameters for each
+ * eye the same way OSVRTrackedHMD::configureDistortionParameters() does.
+ * Returns @c false, after printing why, if it can't be loaded.
+ */
+bool loadDescriptor(const std::string& path, Descriptor& descriptor)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open display descriptor [" << path << "]." << std::endl;
+        return false;
+    }
+    const std::string description { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    try {
+        OSVRDisplayConfiguration configuration(description);
+        descriptor.name = path;
+        descriptor.parameters.clear();
+        for (std::size_t i = 0; i < configuration.getEyes().size(); ++i) {
+            auto distortion = osvr::renderkit::DistortionParameters { configuration, i };
+            distortion.m_desiredTriangles = 200 * 64;
+            descriptor.parameters.push_back(distortion);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Could not parse display descriptor [" << path << "]: " << e.what() << std::endl;
+        return false;
+    }
+
+    if (descriptor.parameters.size() < 2) {
+        std::cerr << "Display descriptor [" << path << "] doesn't describe two eyes." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double getMilliseconds(clock_type::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+/**
+ * Evaluates @c distortion over the same coordinates as timeDistortion(), a
+ * row per batch, and returns the average time per point in nanoseconds.
+ */
+double timeBatchDistortion(const DistortionBatchFunction& distortion, std::size_t grid, float& checksum)
+{
+    std::vector<float> us(grid);
+    for (std::size_t i = 0; i < grid; ++i) {
+        us[i] = static_cast<float>(i) / static_cast<float>(grid - 1);
+    }
+    std::vector<float> vs(grid);
+    std::vector<float> outputs(grid * 6);
+    const DistortionBatch batch = { { &outputs[0 * grid], &outputs[1 * grid] }, { &outputs[2 * grid], &outputs[3 * grid] }, { &outputs[4 * grid], &outputs[5 * grid] } };
+
+    const auto start = clock_type::now();
+    for (std::size_t j = 0; j < grid; ++j) {
+        std::fill(vs.begin(), vs.end(), static_cast<float>(j) / static_cast<float>(grid - 1));
+        distortion(us.data(), vs.data(), grid, batch);
+        for (std::size_t i = 0; i < grid; ++i) {
+            checksum += batch.red[0][i] + batch.green[1][i] + batch.blue[0][i];
+        }
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+    return elapsed.count() / static_cast<double>(grid * grid);
+}
+
+/**
+ * Evaluates @c distortion over the same coordinates as timeDistortion() and
+ * returns percentiles of the time per call in nanoseconds.
+ */
+Json::Value measureLatency(const DistortionFunction& distortion, std::size_t grid, float& checksum)
+{
+    std::vector<double> samples;
+    samples.reserve(grid * (grid + LatencyBlock - 1) / LatencyBlock);
+    for (std::size_t j = 0; j < grid; ++j) {
+        const auto v = static_cast<float>(j) / static_cast<float>(grid - 1);
+        for (std::size_t i = 0; i < grid; i += LatencyBlock) {
+            const auto end = std::min(i + LatencyBlock, grid);
+            const auto start = clock_type::now();
+            for (auto k = i; k < end; ++k) {
+                const auto coords = distortion(static_cast<float>(k) / static_cast<float>(grid - 1), v);
+                checksum += coords.rfRed[0] + coords.rfGreen[1] + coords.rfBlue[0];
+            }
+            const auto elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+            samples.push_back(elapsed.count() / static_cast<double>(end - i));
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const auto percentile = [&samples](std::size_t p) { return samples[std::min(samples.size() - 1, samples.size() * p / 100)]; };
+    Json::Value latency;
+    latency["p50"] = percentile(50);
+    latency["p90"] = percentile(90);
+    latency["p99"] = percentile(99);
+    latency["max"] = samples.back();
+    return latency;
+}
+
+/**
+ * Times a full-grid sweep of @c distortion and its per-call latency and, if
+ * a @c reference is given, measures its error against it.
+ */
+Json::Value measure(const std::string& name, const DistortionFunction& distortion, const DistortionFunction& reference, std::size_t grid, float& checksum)
+{
+    Json::Value result;
+    result["name"] = name;
+    result["sweep_ns"] = timeDistortion(distortion, grid, checksum);
+    result["latency_ns"] = measureLatency(distortion, grid, checksum);
+    if (reference) {
+        result["max_error"] = getMaxDistortionError(distortion, reference, 64, 64);
+    }
+    return result;
+}
+
+/**
+ * Benchmarks every distortion implementation on one set of distortion
+ * parameters. Returns a null value if there's nothing to benchmark.
+ */
+Json::Value benchmarkDescriptor(const Descriptor& descriptor, std::size_t grid, osvr::display::Rotation rotation, float& checksum)
+{
+    Json::Value results;
+    results["name"] = descriptor.name;
+    const auto& parameters = descriptor.parameters[0];
+    const auto samples = getPointSamples(parameters, 0);
+    if (samples.empty()) {
+        std::cerr << "[" << descriptor.name << "] isn't described by point samples; skipping it." << std::endl;
+        return Json::Value();
+    }
+    results["samples"] = static_cast<Json::UInt64>(samples[0]->size());
+    results["colors"] = static_cast<Json::UInt64>(samples.size());
+
+    // Construction, serially and on every hardware thread, for both eyes
+    std::vector<MeshInterpolators> eye_interpolators;
+    for (const auto threads : { std::size_t { 1 }, getDistortionBuildThreads(0) }) {
+        const auto start = clock_type::now();
+        eye_interpolators = makeMeshInterpolators(descriptor.parameters, threads);
+        Json::Value construction;
+        construction["threads"] = static_cast<Json::UInt64>(threads);
+        construction["build_ms"] = getMilliseconds(start);
+        results["construction"].append(construction);
+    }
+
+    const auto& interpolators = eye_interpolators[0];
+    if (interpolators.empty()) {
+        std::cerr << "Could not create mesh interpolators for [" << descriptor.name << "]." << std::endl;
+        return Json::Value();
+    }
+
+    auto& implementations = results["implementations"];
+    const auto reference = [&](float u, float v) { return computeMeshDistortion(0, u, v, parameters, 1.0f, interpolators); };
+    const auto reference_result = measure("interpolators", reference, nullptr, grid, checksum);
+    implementations.append(reference_result);
+
+    // ComputeDistortion() used to work out the rotation and dispatch on it
+    // on every call; a kernel has it compiled in.
+    const std::size_t eye = 1;
+    const auto scanout_origin = osvr::display::ScanOutOrigin::UpperLeft;
+    const auto display_rotation = osvr::display::DesktopOrientation::Landscape - (scanout_origin + rotation);
+    const auto dispatched = [&](float u, float v) {
+        vr::DistortionCoordinates_t coords;
+        const auto batch = makeDistortionBatch(coords);
+        std::tie(u, v) = rotate(u, v, osvr::display::DesktopOrientation::Landscape - (scanout_origin + rotation));
+        storeDistortion(computeMeshDistortion(eye, u, v, descriptor.parameters[eye], 1.0f, eye_interpolators[eye]), batch, 0);
+        return coords;
+    };
+    DistortionSource source;
+    source.parameters = &descriptor.parameters[eye];
+    source.interpolators = &eye_interpolators[eye];
+    const auto kernel = getDistortionKernel(DistortionMode::Interpolator, display_rotation, eye);
+    const auto specialized = [&](float u, float v) {
+        vr::DistortionCoordinates_t coords;
+        kernel(source, &u, &v, 1, makeDistortionBatch(coords));
+        return coords;
+    };
+    implementations.append(measure("interpolators, rotated, runtime dispatch", dispatched, nullptr, grid, checksum));
+    implementations.append(measure("interpolators, rotated, specialized kernel", specialized, dispatched, grid, checksum));
+
+    const auto resolution = getDistortionTableResolution(parameters.m_desiredTriangles);
+    DistortionLookupTable table;
+    auto start = clock_type::now();
+    table.build(resolution, resolution, makeBatchFunction(reference));
+    auto build_ms = getMilliseconds(start);
+    auto result = measure("lookup table", [&](float u, float v) { return table.lookup(u, v); }, reference, grid, checksum);
+    result["build_ms"] = build_ms;
+    result["resolution"] = static_cast<Json::UInt64>(resolution);
+    result["bytes"] = static_cast<Json::UInt64>(resolution * resolution * 6 * sizeof(float));
+    implementations.append(result);
+
+    const auto batch_lookup = [&](const float* u, const float* v, std::size_t count, const DistortionBatch& out) { table.lookup(u, v, count, out); };
+    result = Json::Value();
+    result["name"] = "lookup table, batched";
+    result["sweep_ns"] = timeBatchDistortion(batch_lookup, grid, checksum);
+    implementations.append(result);
+
+    DistortionQuadtree quadtree;
+    start = clock_type::now();
+    quadtree.build(makeBatchFunction(reference), 0.0005f, 8);
+    build_ms = getMilliseconds(start);
+    result = measure("quadtree", [&](float u, float v) { return quadtree.lookup(u, v); }, reference, grid, checksum);
+    result["build_ms"] = build_ms;
+    result["leaves"] = static_cast<Json::UInt64>(quadtree.getLeafCount());
+    result["depth"] = static_cast<Json::UInt64>(quadtree.getDepth());
+    result["bytes"] = static_cast<Json::UInt64>(quadtree.getMemoryUsage());
+    implementations.append(result);
+
+    double polynomial_error = 0.0;
+    start = clock_type::now();
+    const auto polynomial = fitDistortionPolynomial(reference, 0.0005, 5, polynomial_error);
+    build_ms = getMilliseconds(start);
+    if (polynomial.empty()) {
+        result = Json::Value();
+        result["name"] = "polynomial";
+        result["max_error"] = polynomial_error;
+    } else {
+        result = measure("polynomial", [&](float u, float v) { return polynomial.evaluate(u, v); }, reference, grid, checksum);
+        std::ostringstream model;
+        model << polynomial.getModel();
+        result["model"] = model.str();
+    }
+    result["build_ms"] = build_ms;
+    implementations.append(result);
+
+    start = clock_type::now();
+    const auto meshes = makeDistortionMeshes(descriptor.parameters, 1);
+    build_ms = getMilliseconds(start);
+    result = measure("indexed mesh", [&](float u, float v) { return interpolateDistortion(u, v, meshes[0]); }, reference, grid, checksum);
+    const auto statistics = getCacheStatistics(meshes[0]);
+    result["build_ms"] = build_ms; // both eyes
+    result["cache_hits"] = static_cast<Json::UInt64>(statistics.hits);
+    result["cache_misses"] = static_cast<Json::UInt64>(statistics.misses);
+    implementations.append(result);
+
+    return results;
+}
+
+/**
+ * Prints the results of benchmarkDescriptor() for people.
+ */
+void printResults(std::ostream& os, const Json::Value& results)
+{
+    os << results["name"].asString() << " (" << results["samples"].asUInt64() << " samples, " << results["colors"].asUInt64() << " colors):\n";
+    for (const auto& construction : results["construction"]) {
+        os << "  Built mesh interpolators for both eyes in " << construction["build_ms"].asDouble() << " ms using " << construction["threads"].asUInt64() << " threads\n";
+    }
+
+    const auto reference_ns = results["implementations"][0]["sweep_ns"].asDouble();
+    for (const auto& result : results["implementations"]) {
+        os << "  " << result["name"].asString() << ":";
+        if (result.isMember("sweep_ns")) {
+            const auto sweep_ns = result["sweep_ns"].asDouble();
+            os << " " << sweep_ns << " ns per call (" << reference_ns / sweep_ns << "x)";
+        } else {
+            os << " no model within tolerance";
+        }
+        if (result.isMember("latency_ns")) {
+            const auto& latency = result["latency_ns"];
+            os << ", p50 " << latency["p50"].asDouble() << " ns, p99 " << latency["p99"].asDouble() << " ns, max " << latency["max"].asDouble() << " ns";
+        }
+        if (result.isMember("build_ms")) {
+            os << ", built in " << result["build_ms"].asDouble() << " ms";
+        }
+        if (result.isMember("max_error")) {
+            os << ", max error " << result["max_error"].asDouble();
+        }
+        for (const auto& key : { "model", "resolution", "leaves", "depth", "bytes", "cache_hits", "cache_misses" }) {
+            if (result.isMember(key)) {
+                const auto& value = result[key];
+                os << ", " << key << " ";
+                if (value.isString()) {
+                    os << value.asString();
+                } else {
+                    os << value.asUInt64();
+                }
+            }
+        }
+        os << "\n";
+    }
+    os << std::flush;
+}
+
+int usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--grid <size >= 2>] [--rotation <0, 90, 180 or 270>] [--json <file, or - for stdout>] [display descriptor...]" << std::endl;
+    return EXIT_FAILURE;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    // SteamVR samples the distortion on a grid of roughly this size
+    std::size_t grid = 256;
+    auto degrees = 90;
+    std::string json_path;
+    std::vector<std::string> descriptor_paths;
+    for (auto i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ("--grid" == arg && i + 1 < argc) {
+            grid = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if ("--rotation" == arg && i + 1 < argc) {
+            degrees = std::atoi(argv[++i]);
+        } else if ("--json" == arg && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (!arg.empty() && '-' == arg[0]) {
+            return usage(argv[0]);
+        } else {
+            descriptor_paths.push_back(arg);
+        }
+    }
+    if (grid < 2 || degrees < 0 || degrees > 270 || degrees % 90 != 0) {
+        return usage(argv[0]);
+    }
+    const osvr::display::Rotation rotations[] = { osvr::display::Rotation::Zero, osvr::display::Rotation::Ninety, osvr::display::Rotation::OneEighty, osvr::display::Rotation::TwoSeventy };
+    const auto rotation = rotations[degrees / 90];
+
+    // Sample grids from sparse to denser than an HDK descriptor, then any
+    // real display descriptors
+    std::vector<Descriptor> descriptors;
+    for (const std::size_t samples : { 17, 33, 65, 81 }) {
+        descriptors.push_back(makeSyntheticDescriptor(samples));
+    }
+    for (const auto& path : descriptor_paths) {
+        Descriptor descriptor;
+        if (!loadDescriptor(path, descriptor))
+            return EXIT_FAILURE;
+        descriptors.push_back(std::move(descriptor));
+    }
+
+    // With JSON on stdout, the human-readable results go to stderr instead.
+    auto& text = ("-" == json_path) ? std::cerr : std::cout;
+
+    Json::Value report;
+    report["grid"] = static_cast<Json::UInt64>(grid);
+    report["rotation"] = degrees;
+    report["hardware_threads"] = static_cast<Json::UInt64>(getDistortionBuildThreads(0));
+    report["latency_block"] = static_cast<Json::UInt64>(LatencyBlock);
+    report["descriptors"] = Json::Value(Json::arrayValue);
+
+    float checksum = 0.0f;
+    for (const auto& descriptor : descriptors) {
+        const auto results = benchmarkDescriptor(descriptor, grid, rotation, checksum);
+        if (results.isNull())
+            continue;
+        printResults(text, results);
+        report["descriptors"].append(results);
+    }
+    report["checksum"] = checksum;
+    text << "(checksum " << checksum << ")" << std::endl;
+
+    if ("-" == json_path) {
+        std::cout << report;
+    } else if (!json_path.empty()) {
+        std::ofstream file(json_path);
+        file << report;
+        if (!file) {
+            std::cerr << "Could not write [" << json_path << "]." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
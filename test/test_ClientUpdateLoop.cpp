@@ -0,0 +1,124 @@
+/** @file
+    @brief Tests for ClientUpdateLoop
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "ClientUpdateLoop.h"
+
+// Library/third-party includes
+#include <osvr/ClientKit/Context.h>
+
+// Standard includes
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+using clock = ClientUpdateLoop::clock;
+
+/**
+ * Stands in for the HMD's report counter: a tracker that reports at a
+ * steady rate. Only "dispatches" the reports that have arrived whenever
+ * update() runs, and keeps track of how long they waited.
+ */
+class FakeTracker {
+public:
+    explicit FakeTracker(clock::duration period) : period_(period), start_(clock::now())
+    {
+        // do nothing
+    }
+
+    /// Called after each update(), on the update thread.
+    void dispatch()
+    {
+        const auto now = clock::now();
+        const auto arrived = static_cast<std::uint64_t>((now - start_) / period_);
+        for (; dispatched_ < arrived; ++dispatched_) {
+            totalLatency_ += now - (start_ + period_ * static_cast<clock::rep>(dispatched_ + 1));
+        }
+    }
+
+    std::uint64_t getReportCount() const
+    {
+        return dispatched_;
+    }
+
+    std::chrono::duration<double> getMeanLatency() const
+    {
+        return (0 == dispatched_) ? clock::duration::zero() : totalLatency_ / static_cast<clock::rep>(dispatched_);
+    }
+
+private:
+    clock::duration period_;
+    clock::time_point start_;
+    std::uint64_t dispatched_ = 0;
+    clock::duration totalLatency_ = clock::duration::zero();
+};
+
+struct RunStatistics {
+    std::uint64_t updates;
+    std::uint64_t reports;
+    std::chrono::duration<double> meanLatency;
+};
+
+RunStatistics run(osvr::clientkit::ClientContext& context, ClientUpdateLoop::Mode mode, clock::duration report_period, clock::duration run_time)
+{
+    FakeTracker tracker(report_period);
+    ClientUpdateLoop loop(context);
+    loop.setMode(mode);
+    loop.setReportCounter([&tracker] { return tracker.getReportCount(); });
+    loop.setAfterUpdate([&tracker] { tracker.dispatch(); });
+    loop.start();
+    std::this_thread::sleep_for(run_time);
+    loop.stop();
+
+    return { loop.getUpdateCount(), tracker.getReportCount(), tracker.getMeanLatency() };
+}
+
+} // anonymous namespace
+
+TEST_CASE("Event mode wakes up less often than fixed mode", "[ClientUpdateLoop]")
+{
+    osvr::clientkit::ClientContext context("org.osvr.SteamVR.test_ClientUpdateLoop");
+
+    // A 250 Hz tracker against the default 1 ms active wait period
+    const auto report_period = std::chrono::milliseconds(4);
+    const auto run_time = std::chrono::milliseconds(500);
+    const auto fixed = run(context, ClientUpdateLoop::Mode::Fixed, report_period, run_time);
+    const auto event = run(context, ClientUpdateLoop::Mode::Event, report_period, run_time);
+    INFO("Fixed mode: " << fixed.updates << " updates for " << fixed.reports << " reports, mean latency " << fixed.meanLatency.count() * 1000.0 << " ms");
+    INFO("Event mode: " << event.updates << " updates for " << event.reports << " reports, mean latency " << event.meanLatency.count() * 1000.0 << " ms");
+
+    // About one wakeup per report, plus a few while learning the period and
+    // after the occasional miss
+    CHECK(event.updates * 2 < fixed.updates);
+    CHECK(event.updates < event.reports * 2);
+
+    // ...without holding the reports back for long
+    CHECK(event.meanLatency < std::chrono::duration<double>(report_period) / 2);
+}
@@ -0,0 +1,117 @@
+/** @file
+    @brief Tests for the pose_at debug request
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "OSVRTrackedHMD.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+#include <osvr/ClientKit/Context.h>
+#include <osvr/Util/TimeValue.h>
+
+// Standard includes
+#include <cstring>
+#include <string>
+
+namespace {
+
+/// Lets the test feed poses without an OSVR server. Reports are coalesced
+/// and never flushed so nothing is sent to SteamVR.
+class TestHMD : public OSVRTrackedHMD {
+public:
+    TestHMD(osvr::clientkit::ClientContext& context) : OSVRTrackedHMD(context)
+    {
+        setCoalescePoses(true);
+    }
+
+    using OSVRTrackedHMD::publishPose;
+};
+
+vr::DriverPose_t makePose(double x, double y, double z)
+{
+    vr::DriverPose_t pose = {};
+    pose.poseIsValid = true;
+    pose.result = vr::TrackingResult_Running_OK;
+    pose.deviceIsConnected = true;
+    pose.vecPosition[0] = x;
+    pose.vecPosition[1] = y;
+    pose.vecPosition[2] = z;
+    pose.qRotation.w = 1.0;
+    return pose;
+}
+
+/// Sends the request the way SteamVR does, through the driver interface.
+std::string debugRequest(vr::ITrackedDeviceServerDriver& driver, const char* request, uint32_t size = vr::k_unMaxDriverDebugResponseSize)
+{
+    std::string buffer(size, 'x');
+    driver.DebugRequest(request, &buffer[0], size);
+    return std::string(buffer.c_str());
+}
+
+} // namespace
+
+TEST_CASE("HMD answers pose_at debug requests")
+{
+    osvr::clientkit::ClientContext context("com.osvr.SteamVR.test_DebugRequest");
+    TestHMD hmd(context);
+
+    SECTION("No poses yet")
+    {
+        const auto response = debugRequest(hmd, "pose_at 0");
+        CHECK(response.find("\"valid\": false") != std::string::npos);
+    }
+
+    SECTION("Latest pose")
+    {
+        hmd.publishPose(makePose(1.0, 2.0, 3.0), osvr::util::time::getNow());
+        const auto response = debugRequest(hmd, "pose_at 0");
+        CHECK(response.find("\"valid\": true") != std::string::npos);
+        CHECK(response.find("\"position\": [1, 2, 3]") != std::string::npos);
+        CHECK(response.find("\"orientation\": [1, 0, 0, 0]") != std::string::npos);
+    }
+
+    SECTION("Outside the history")
+    {
+        hmd.publishPose(makePose(1.0, 2.0, 3.0), osvr::util::time::getNow());
+        const auto response = debugRequest(hmd, "pose_at 10000");
+        CHECK(response.find("\"valid\": false") != std::string::npos);
+    }
+
+    SECTION("Truncated response")
+    {
+        hmd.publishPose(makePose(1.0, 2.0, 3.0), osvr::util::time::getNow());
+        const auto response = debugRequest(hmd, "pose_at 0", 8);
+        CHECK(response == "{\"valid");
+    }
+
+    SECTION("Unknown request")
+    {
+        CHECK(debugRequest(hmd, "version").empty());
+    }
+}
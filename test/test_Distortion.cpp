@@ -0,0 +1,172 @@
+/** @file
+    @brief Tests for the distortion lookup table
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "Distortion.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+vr::DistortionCoordinates_t barrel(float u, float v)
+{
+    const auto du = u - 0.5f;
+    const auto dv = v - 0.5f;
+    const auto r2 = du * du + dv * dv;
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = 0.5f + du * (1.0f + 0.22f * r2);
+    coords.rfRed[1] = 0.5f + dv * (1.0f + 0.22f * r2);
+    coords.rfGreen[0] = 0.5f + du * (1.0f + 0.24f * r2);
+    coords.rfGreen[1] = 0.5f + dv * (1.0f + 0.24f * r2);
+    coords.rfBlue[0] = 0.5f + du * (1.0f + 0.26f * r2);
+    coords.rfBlue[1] = 0.5f + dv * (1.0f + 0.26f * r2);
+    return coords;
+}
+
+} // anonymous namespace
+
+TEST_CASE("DistortionLookupTable reproduces its nodes", "[DistortionLookupTable]")
+{
+    DistortionLookupTable table;
+    CHECK(table.empty());
+
+    table.build(11, 6, makeBatchFunction(barrel), 3);
+    REQUIRE_FALSE(table.empty());
+    CHECK(table.getWidth() == 11);
+    CHECK(table.getHeight() == 6);
+
+    for (std::size_t j = 0; j < 6; ++j) {
+        for (std::size_t i = 0; i < 11; ++i) {
+            const auto u = static_cast<float>(i) / 10.0f;
+            const auto v = static_cast<float>(j) / 5.0f;
+            const auto expected = barrel(u, v);
+            const auto actual = table.lookup(u, v);
+            CHECK(actual.rfRed[0] == Approx(expected.rfRed[0]));
+            CHECK(actual.rfGreen[1] == Approx(expected.rfGreen[1]));
+            CHECK(actual.rfBlue[0] == Approx(expected.rfBlue[0]));
+        }
+    }
+
+    CHECK(table.getMaxError(barrel) < 1e-2);
+}
+
+TEST_CASE("DistortionLookupTable batches match single lookups", "[DistortionLookupTable]")
+{
+    DistortionLookupTable table;
+    table.build(33, 33, makeBatchFunction(barrel));
+
+    // An odd count exercises both the vectorized and scalar paths, and the
+    // points outside [0, 1] exercise the clamping.
+    std::vector<float> us;
+    std::vector<float> vs;
+    for (int i = 0; i < 103; ++i) {
+        us.push_back(-0.1f + 0.0117f * static_cast<float>(i));
+        vs.push_back(1.1f - 0.0113f * static_cast<float>(i));
+    }
+
+    const auto count = us.size();
+    std::vector<float> outputs(count * 6);
+    const DistortionBatch batch = { { &outputs[0 * count], &outputs[1 * count] }, { &outputs[2 * count], &outputs[3 * count] }, { &outputs[4 * count], &outputs[5 * count] } };
+    table.lookup(us.data(), vs.data(), count, batch);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto expected = table.lookup(us[i], vs[i]);
+        INFO("(" << us[i] << ", " << vs[i] << ")");
+        CHECK(batch.red[0][i] == Approx(expected.rfRed[0]));
+        CHECK(batch.red[1][i] == Approx(expected.rfRed[1]));
+        CHECK(batch.green[0][i] == Approx(expected.rfGreen[0]));
+        CHECK(batch.green[1][i] == Approx(expected.rfGreen[1]));
+        CHECK(batch.blue[0][i] == Approx(expected.rfBlue[0]));
+        CHECK(batch.blue[1][i] == Approx(expected.rfBlue[1]));
+    }
+}
+
+TEST_CASE("A batch of one writes to DistortionCoordinates_t", "[DistortionLookupTable]")
+{
+    DistortionLookupTable table;
+    table.build(5, 5, makeBatchFunction(barrel));
+
+    const auto u = 0.3f;
+    const auto v = 0.8f;
+    vr::DistortionCoordinates_t coords;
+    table.lookup(&u, &v, 1, makeDistortionBatch(coords));
+
+    const auto expected = table.lookup(u, v);
+    CHECK(coords.rfRed[0] == expected.rfRed[0]);
+    CHECK(coords.rfGreen[1] == expected.rfGreen[1]);
+    CHECK(coords.rfBlue[1] == expected.rfBlue[1]);
+}
+
+TEST_CASE("getDistortionJacobian differentiates the green channel", "[Distortion]")
+{
+    // At the center, the barrel distortion is just the identity.
+    const auto center = getDistortionJacobian(barrel, 0.5f, 0.5f);
+    CHECK(center[0] == Approx(1.0).epsilon(1e-3));
+    CHECK(std::abs(center[1]) < 1e-6);
+    CHECK(std::abs(center[2]) < 1e-6);
+    CHECK(center[3] == Approx(1.0).epsilon(1e-3));
+
+    // Elsewhere, compare with the analytic derivative.
+    const auto du = 0.3f;
+    const auto jacobian = getDistortionJacobian(barrel, 0.5f + du, 0.5f);
+    CHECK(jacobian[0] == Approx(1.0 + 3.0 * 0.24 * du * du).epsilon(1e-3));
+    CHECK(jacobian[3] == Approx(1.0 + 0.24 * du * du).epsilon(1e-3));
+}
+
+TEST_CASE("getRenderTargetSize compensates for magnification", "[Distortion]")
+{
+    const auto identity = getRenderTargetSize({ { 1.0, 0.0, 0.0, 1.0 } }, 1080, 1200, 1.0);
+    CHECK(identity.first == 1080);
+    CHECK(identity.second == 1200);
+
+    // A lens magnifying twice as much horizontally needs twice the pixels.
+    const auto magnified = getRenderTargetSize({ { 0.5, 0.0, 0.0, 0.8 } }, 1080, 1200, 1.0);
+    CHECK(magnified.first == 2160);
+    CHECK(magnified.second == 1500);
+
+    const auto denser = getRenderTargetSize({ { 0.5, 0.0, 0.0, 0.8 } }, 1080, 1200, 1.5);
+    CHECK(denser.first == 3240);
+    CHECK(denser.second == 2250);
+
+    // A display rotated 90 degrees swaps which viewport axis each render
+    // target axis comes from.
+    const auto rotated = getRenderTargetSize({ { 0.0, 0.5, 1.0, 0.0 } }, 1080, 1200, 1.0);
+    CHECK(rotated.first == 2400);
+    CHECK(rotated.second == 1080);
+
+    const auto singular = getRenderTargetSize({ { 0.0, 0.0, 0.0, 0.0 } }, 1080, 1200, 1.0);
+    CHECK(singular.first == 0);
+    CHECK(singular.second == 0);
+}
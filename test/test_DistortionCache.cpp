@@ -0,0 +1,278 @@
+/** @file
+    @brief Tests for the distortion cache
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "Distortion.h"
+#include "DistortionCache.h"
+#include "DistortionMesh.h"
+#include "DistortionPolynomial.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+const std::string CachePath = "test_DistortionCache.cache";
+
+DistortionFunction makeDistortion(float offset)
+{
+    return [offset](float u, float v) {
+        vr::DistortionCoordinates_t coords;
+        coords.rfRed[0] = u * 0.99f + offset;
+        coords.rfRed[1] = v * 0.99f + 0.1f * u * v;
+        coords.rfGreen[0] = u + offset;
+        coords.rfGreen[1] = v + 0.1f * u * v;
+        coords.rfBlue[0] = u * 1.01f + offset;
+        coords.rfBlue[1] = v * 1.01f + 0.1f * u * v;
+        return coords;
+    };
+}
+
+DistortionLookupTable makeTable(float offset)
+{
+    DistortionLookupTable table;
+    table.build(9, 7, makeBatchFunction(makeDistortion(offset)));
+    return table;
+}
+
+DistortionMeshes makeMeshes(float offset)
+{
+    MonoPointDistortionMeshDescription samples;
+    for (std::size_t j = 0; j < 5; ++j) {
+        for (std::size_t i = 0; i < 5; ++i) {
+            const auto u = i / 4.0;
+            const auto v = j / 4.0;
+            samples.push_back({ { { { u, v } }, { { u * 0.9 + offset, v * 1.1 + 0.1 * u * v } } } });
+        }
+    }
+    DistortionMeshes meshes(1);
+    meshes[0].build(samples);
+    return meshes;
+}
+
+/**
+ * Checks that two pieces of distortion data give the same distortion.
+ */
+template <typename Lookup>
+void checkSameDistortion(Lookup expected, Lookup actual)
+{
+    for (const auto u : { 0.0f, 0.3f, 0.55f, 1.0f }) {
+        for (const auto v : { 0.0f, 0.45f, 0.8f, 1.0f }) {
+            const auto a = expected(u, v);
+            const auto b = actual(u, v);
+            INFO("(" << u << ", " << v << ")");
+            CHECK(a.rfRed[0] == b.rfRed[0]);
+            CHECK(a.rfRed[1] == b.rfRed[1]);
+            CHECK(a.rfBlue[0] == b.rfBlue[0]);
+            CHECK(a.rfBlue[1] == b.rfBlue[1]);
+        }
+    }
+}
+
+/**
+ * Overwrites one byte of a file.
+ */
+void corruptByte(const std::string& path, std::streamoff offset)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(offset);
+    const auto byte = static_cast<char>(file.get() ^ 0x5a);
+    file.seekp(offset);
+    file.put(byte);
+}
+
+} // anonymous namespace
+
+TEST_CASE("FNV-1a hashes match the reference values", "[DistortionCache]")
+{
+    CHECK(fnv1aHash("", 0) == 0xcbf29ce484222325ULL);
+    CHECK(fnv1aHash("a", 1) == 0xaf63dc4c8601ec8cULL);
+    CHECK(fnv1aHash("foobar", 6) == 0x85944171f73967e8ULL);
+    CHECK(fnv1aHash("bar", 3, fnv1aHash("foo", 3)) == fnv1aHash("foobar", 6));
+}
+
+TEST_CASE("Distortion cache round trip", "[DistortionCache]")
+{
+    const std::uint64_t key = 42;
+    const auto left = makeTable(0.0f);
+    const auto right = makeTable(0.5f);
+    REQUIRE(saveDistortionCache(CachePath, key, left, right));
+
+    DistortionLookupTable loaded_left;
+    DistortionLookupTable loaded_right;
+
+    SECTION("Matching key")
+    {
+        REQUIRE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+        CHECK(loaded_left.getWidth() == 9);
+        CHECK(loaded_left.getHeight() == 7);
+        CHECK(loaded_left.getValues() == left.getValues());
+        CHECK(loaded_right.getValues() == right.getValues());
+    }
+
+    SECTION("Different key")
+    {
+        CHECK_FALSE(loadDistortionCache(CachePath, key + 1, loaded_left, loaded_right));
+        CHECK(loaded_left.empty());
+    }
+
+    SECTION("Corrupt payload")
+    {
+        corruptByte(CachePath, 100);
+        CHECK_FALSE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    }
+
+    SECTION("Corrupt header")
+    {
+        corruptByte(CachePath, 0);
+        CHECK_FALSE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    }
+
+    SECTION("Truncated file")
+    {
+        std::ofstream(CachePath, std::ios::binary | std::ios::trunc) << "OSVR";
+        CHECK_FALSE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    }
+
+    std::remove(CachePath.c_str());
+}
+
+TEST_CASE("Distortion mesh cache round trip", "[DistortionCache]")
+{
+    const std::uint64_t key = 7;
+    const auto left = makeMeshes(0.0f);
+    const auto right = makeMeshes(0.25f);
+    REQUIRE(saveDistortionCache(CachePath, key, left, right));
+
+    DistortionMeshes loaded_left;
+    DistortionMeshes loaded_right;
+    REQUIRE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    REQUIRE(loaded_left.size() == 1);
+    REQUIRE(loaded_right.size() == 1);
+    CHECK(loaded_left[0].getTriangleCount() == left[0].getTriangleCount());
+    CHECK(loaded_left[0].getChannelCount() == 1);
+    for (const auto u : { -0.1f, 0.0f, 0.3f, 0.55f, 1.0f }) {
+        for (const auto v : { 0.0f, 0.45f, 0.8f, 1.1f }) {
+            INFO("(" << u << ", " << v << ")");
+            CHECK(loaded_left[0].interpolate(u, v) == left[0].interpolate(u, v));
+            CHECK(loaded_right[0].interpolate(u, v) == right[0].interpolate(u, v));
+        }
+    }
+
+    std::remove(CachePath.c_str());
+}
+
+TEST_CASE("Distortion quadtree cache round trip", "[DistortionCache]")
+{
+    const std::uint64_t key = 7;
+    DistortionQuadtree left;
+    DistortionQuadtree right;
+    left.build(makeBatchFunction(makeDistortion(0.0f)), 1e-4f, 6);
+    right.build(makeBatchFunction(makeDistortion(0.5f)), 1e-4f, 6);
+    REQUIRE(saveDistortionCache(CachePath, key, left, right));
+
+    DistortionQuadtree loaded_left;
+    DistortionQuadtree loaded_right;
+    REQUIRE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    CHECK(loaded_left.getLeafCount() == left.getLeafCount());
+    CHECK(loaded_left.getDepth() == left.getDepth());
+    const auto lookup = [](const DistortionQuadtree& quadtree) { return [&quadtree](float u, float v) { return quadtree.lookup(u, v); }; };
+    checkSameDistortion(lookup(left), lookup(loaded_left));
+    checkSameDistortion(lookup(right), lookup(loaded_right));
+
+    std::remove(CachePath.c_str());
+}
+
+TEST_CASE("Distortion polynomial cache round trip", "[DistortionCache]")
+{
+    const std::uint64_t key = 7;
+    DistortionPolynomial left;
+    DistortionPolynomial right;
+    REQUIRE(left.fitPolynomial(sampleDistortion(makeDistortion(0.0f), 9), 2));
+    REQUIRE(right.fitRadial(sampleDistortion(makeDistortion(0.5f), 9)));
+    REQUIRE(saveDistortionCache(CachePath, key, left, right));
+
+    DistortionPolynomial loaded_left;
+    DistortionPolynomial loaded_right;
+    REQUIRE(loadDistortionCache(CachePath, key, loaded_left, loaded_right));
+    CHECK(loaded_left.getModel() == DistortionPolynomial::Model::Polynomial);
+    CHECK(loaded_left.getDegree() == 2);
+    CHECK(loaded_right.getModel() == DistortionPolynomial::Model::Radial);
+    const auto evaluate = [](const DistortionPolynomial& polynomial) { return [&polynomial](float u, float v) { return polynomial.evaluate(u, v); }; };
+    checkSameDistortion(evaluate(left), evaluate(loaded_left));
+    checkSameDistortion(evaluate(right), evaluate(loaded_right));
+
+    std::remove(CachePath.c_str());
+}
+
+TEST_CASE("Distortion cache holding a different kind of data", "[DistortionCache]")
+{
+    const std::uint64_t key = 42;
+    REQUIRE(saveDistortionCache(CachePath, key, makeTable(0.0f), makeTable(0.5f)));
+
+    // A failed load leaves what was there before.
+    auto left = makeMeshes(0.0f);
+    auto right = makeMeshes(0.25f);
+    CHECK_FALSE(loadDistortionCache(CachePath, key, left, right));
+    CHECK(left.size() == 1);
+    CHECK_FALSE(left[0].empty());
+
+    DistortionQuadtree left_quadtree;
+    DistortionQuadtree right_quadtree;
+    CHECK_FALSE(loadDistortionCache(CachePath, key, left_quadtree, right_quadtree));
+    CHECK(left_quadtree.empty());
+
+    std::remove(CachePath.c_str());
+}
+
+TEST_CASE("Empty distortion data isn't cached", "[DistortionCache]")
+{
+    std::remove(CachePath.c_str());
+    CHECK_FALSE(saveDistortionCache(CachePath, 42, DistortionMeshes(), makeMeshes(0.0f)));
+    CHECK_FALSE(saveDistortionCache(CachePath, 42, DistortionQuadtree(), DistortionQuadtree()));
+    CHECK_FALSE(saveDistortionCache(CachePath, 42, DistortionPolynomial(), DistortionPolynomial()));
+    DistortionLookupTable left;
+    DistortionLookupTable right;
+    CHECK_FALSE(loadDistortionCache(CachePath, 42, left, right));
+}
+
+TEST_CASE("Missing distortion cache", "[DistortionCache]")
+{
+    std::remove(CachePath.c_str());
+    DistortionLookupTable left;
+    DistortionLookupTable right;
+    CHECK_FALSE(loadDistortionCache(CachePath, 42, left, right));
+}
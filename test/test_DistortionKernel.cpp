@@ -0,0 +1,187 @@
+/** @file
+    @brief Tests for the distortion kernels
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "Distortion.h"
+#include "DistortionKernel.h"
+#include "DistortionMesh.h"
+#include "DistortionPolynomial.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+#include <osvr/Display/Display.h>
+#include <osvr/RenderKit/DistortionParameters.h>
+
+// Standard includes
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+const osvr::display::Rotation Rotations[] = { osvr::display::Rotation::Zero, osvr::display::Rotation::Ninety, osvr::display::Rotation::OneEighty, osvr::display::Rotation::TwoSeventy };
+
+/**
+ * Mono point samples of an off-center barrel distortion, different for each
+ * eye, so a kernel using the wrong rotation or eye gets different results.
+ */
+osvr::renderkit::DistortionParameters makeParameters()
+{
+    osvr::renderkit::DistortionParameters parameters;
+    parameters.m_type = osvr::renderkit::DistortionParameters::mono_point_samples;
+    parameters.m_desiredTriangles = 800;
+    parameters.m_monoPointSamples.resize(2);
+    for (std::size_t eye = 0; eye < 2; ++eye) {
+        const auto center = (0 == eye) ? 0.45 : 0.55;
+        for (std::size_t j = 0; j < 17; ++j) {
+            for (std::size_t i = 0; i < 17; ++i) {
+                const auto x = static_cast<double>(i) / 16.0;
+                const auto y = static_cast<double>(j) / 16.0;
+                const auto dx = x - center;
+                const auto dy = y - 0.4;
+                const auto scale = 1.0 + 0.25 * (dx * dx + dy * dy);
+                parameters.m_monoPointSamples[eye].push_back({ { { { x, y } }, { { center + dx * scale, 0.4 + dy * scale } } } });
+            }
+        }
+    }
+    return parameters;
+}
+
+vr::DistortionCoordinates_t runKernel(DistortionKernel kernel, const DistortionSource& source, float u, float v)
+{
+    vr::DistortionCoordinates_t coords;
+    kernel(source, &u, &v, 1, makeDistortionBatch(coords));
+    return coords;
+}
+
+void checkEqual(const vr::DistortionCoordinates_t& actual, const vr::DistortionCoordinates_t& expected)
+{
+    CHECK(actual.rfRed[0] == expected.rfRed[0]);
+    CHECK(actual.rfRed[1] == expected.rfRed[1]);
+    CHECK(actual.rfGreen[0] == expected.rfGreen[0]);
+    CHECK(actual.rfGreen[1] == expected.rfGreen[1]);
+    CHECK(actual.rfBlue[0] == expected.rfBlue[0]);
+    CHECK(actual.rfBlue[1] == expected.rfBlue[1]);
+}
+
+} // anonymous namespace
+
+TEST_CASE("Interpolator kernels match rotating at runtime", "[DistortionKernel]")
+{
+    const auto parameters = makeParameters();
+    const auto interpolators = makeMeshInterpolators({ parameters, parameters }, 2);
+    REQUIRE(interpolators.size() == 2);
+
+    for (const auto rotation : Rotations) {
+        for (std::size_t eye = 0; eye < 2; ++eye) {
+            DistortionSource source;
+            source.parameters = &parameters;
+            source.interpolators = &interpolators[eye];
+            const auto kernel = getDistortionKernel(DistortionMode::Interpolator, rotation, eye);
+
+            for (float v = 0.0f; v <= 1.0f; v += 0.13f) {
+                for (float u = 0.0f; u <= 1.0f; u += 0.17f) {
+                    const auto rotated = rotate(u, v, rotation);
+                    INFO("Rotation " << rotation << ", eye " << eye << ", (" << u << ", " << v << ")");
+                    checkEqual(runKernel(kernel, source, u, v), computeMeshDistortion(eye, rotated.first, rotated.second, parameters, 1.0f, interpolators[eye]));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Mesh kernels match rotating at runtime", "[DistortionKernel]")
+{
+    const auto parameters = makeParameters();
+    const auto meshes = makeDistortionMeshes({ parameters, parameters }, 2);
+    REQUIRE(meshes.size() == 2);
+
+    for (const auto rotation : Rotations) {
+        for (std::size_t eye = 0; eye < 2; ++eye) {
+            REQUIRE_FALSE(meshes[eye].empty());
+            DistortionSource source;
+            source.meshes = &meshes[eye];
+            source.overfillFactor = 1.25f;
+            const auto kernel = getDistortionKernel(DistortionMode::Mesh, rotation, eye);
+
+            for (float v = 0.0f; v <= 1.0f; v += 0.13f) {
+                for (float u = 0.0f; u <= 1.0f; u += 0.17f) {
+                    const auto rotated = rotate(u, v, rotation);
+                    INFO("Rotation " << rotation << ", eye " << eye << ", (" << u << ", " << v << ")");
+                    checkEqual(runKernel(kernel, source, u, v), interpolateDistortion(rotated.first, rotated.second, meshes[eye], source.overfillFactor));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("The table and quadtree kernels look up their data", "[DistortionKernel]")
+{
+    const auto parameters = makeParameters();
+    const auto meshes = makeDistortionMeshes({ parameters, parameters }, 1);
+    DistortionLookupTable table;
+    table.build(9, 9, makeBatchFunction([&meshes](float u, float v) { return interpolateDistortion(u, v, meshes[0]); }));
+
+    DistortionQuadtree quadtree;
+    quadtree.build(makeBatchFunction([&meshes](float u, float v) { return interpolateDistortion(u, v, meshes[0]); }), 1e-3f, 4);
+
+    DistortionSource source;
+    source.table = &table;
+    source.quadtree = &quadtree;
+    for (const auto rotation : Rotations) {
+        const auto table_kernel = getDistortionKernel(DistortionMode::Table, rotation, 1);
+        checkEqual(runKernel(table_kernel, source, 0.3f, 0.7f), table.lookup(0.3f, 0.7f));
+        const auto quadtree_kernel = getDistortionKernel(DistortionMode::Quadtree, rotation, 1);
+        checkEqual(runKernel(quadtree_kernel, source, 0.3f, 0.7f), quadtree.lookup(0.3f, 0.7f));
+    }
+}
+
+TEST_CASE("The polynomial kernel evaluates its model", "[DistortionKernel]")
+{
+    const auto parameters = makeParameters();
+    const auto meshes = makeDistortionMeshes({ parameters, parameters }, 1);
+    DistortionPolynomial polynomial;
+    polynomial.fitPolynomial(sampleDistortion([&meshes](float u, float v) { return interpolateDistortion(u, v, meshes[0]); }, 17), 3);
+    REQUIRE_FALSE(polynomial.empty());
+
+    DistortionSource source;
+    source.polynomial = &polynomial;
+    for (const auto rotation : Rotations) {
+        const auto kernel = getDistortionKernel(DistortionMode::Polynomial, rotation, 0);
+        checkEqual(runKernel(kernel, source, 0.3f, 0.7f), polynomial.evaluate(0.3f, 0.7f));
+    }
+}
+
+TEST_CASE("The identity kernel leaves coordinates alone", "[DistortionKernel]")
+{
+    const auto coords = runKernel(getIdentityDistortionKernel(), DistortionSource {}, 0.25f, 0.75f);
+    CHECK(coords.rfRed[0] == 0.25f);
+    CHECK(coords.rfGreen[0] == 0.25f);
+    CHECK(coords.rfBlue[1] == 0.75f);
+}
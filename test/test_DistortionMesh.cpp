@@ -0,0 +1,290 @@
+/** @file
+    @brief Tests for DistortionMesh
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "DistortionMesh.h"
+
+// Library/third-party includes
+#include <osvr/RenderKit/DistortionParameters.h>
+#include <osvr/RenderKit/osvr_display_configuration.h>
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * An affine distortion, which a triangle mesh reproduces exactly.
+ */
+std::array<double, 2> affine(double u, double v)
+{
+    return { { 0.1 + 0.9 * u + 0.05 * v, -0.02 + 0.03 * u + 1.1 * v } };
+}
+
+/**
+ * Samples a regular grid. @c scale scales the distortion about (0.5, 0.5) to
+ * make a different channel.
+ */
+MonoPointDistortionMeshDescription makeGridSamples(std::size_t size, double scale = 1.0)
+{
+    MonoPointDistortionMeshDescription samples;
+    for (std::size_t j = 0; j < size; ++j) {
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto u = static_cast<double>(i) / static_cast<double>(size - 1);
+            const auto v = static_cast<double>(j) / static_cast<double>(size - 1);
+            const auto out = affine(u, v);
+            samples.push_back({ { { { u, v } }, { { 0.5 + (out[0] - 0.5) * scale, 0.5 + (out[1] - 0.5) * scale } } } });
+        }
+    }
+    return samples;
+}
+
+osvr::renderkit::DistortionParameters makeRgbParameters(const MonoPointDistortionMeshDescription& red, const MonoPointDistortionMeshDescription& green, const MonoPointDistortionMeshDescription& blue)
+{
+    osvr::renderkit::DistortionParameters parameters;
+    parameters.m_type = osvr::renderkit::DistortionParameters::rgb_point_samples;
+    parameters.m_rgbPointSamples = { { red, red }, { green, green }, { blue, blue } };
+    return parameters;
+}
+
+void checkAffine(const DistortionMesh& mesh, float u, float v)
+{
+    const auto expected = affine(u, v);
+    const auto actual = mesh.interpolate(u, v);
+    INFO("(" << u << ", " << v << ")");
+    CHECK(actual[0] == Approx(expected[0]).epsilon(1e-4));
+    CHECK(actual[1] == Approx(expected[1]).epsilon(1e-4));
+}
+
+} // anonymous namespace
+
+TEST_CASE("DistortionMesh starts out empty", "[DistortionMesh]")
+{
+    DistortionMesh mesh;
+    CHECK(mesh.empty());
+
+    mesh.build(MonoPointDistortionMeshDescription {});
+    CHECK(mesh.empty());
+}
+
+TEST_CASE("DistortionMesh triangulates a regular grid", "[DistortionMesh]")
+{
+    DistortionMesh mesh;
+    mesh.build(makeGridSamples(33));
+    REQUIRE_FALSE(mesh.empty());
+    CHECK(mesh.getTriangleCount() == 2 * 32 * 32);
+    // origin, inverse, neighbours and one channel of values per triangle
+    CHECK(mesh.getMemoryUsage() >= mesh.getTriangleCount() * 15 * 4);
+
+    SECTION("Samples are reproduced exactly")
+    {
+        checkAffine(mesh, 0.0f, 0.0f);
+        checkAffine(mesh, 0.5f, 0.25f);
+        checkAffine(mesh, 1.0f, 1.0f);
+    }
+
+    SECTION("Points between samples are interpolated")
+    {
+        for (float v = 0.0f; v <= 1.0f; v += 0.037f) {
+            for (float u = 0.0f; u <= 1.0f; u += 0.041f) {
+                checkAffine(mesh, u, v);
+            }
+        }
+    }
+
+    SECTION("Points outside the mesh are extrapolated")
+    {
+        checkAffine(mesh, -0.1f, 0.5f);
+        checkAffine(mesh, 1.2f, -0.3f);
+        checkAffine(mesh, 0.5f, 1.05f);
+    }
+}
+
+TEST_CASE("DistortionMesh triangulates scattered samples", "[DistortionMesh]")
+{
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+    MonoPointDistortionMeshDescription samples;
+    for (std::size_t i = 0; i < 2000; ++i) {
+        const auto u = distribution(generator);
+        const auto v = distribution(generator);
+        samples.push_back({ { { { u, v } }, affine(u, v) } });
+    }
+    // Duplicates are dropped
+    samples.push_back(samples.front());
+
+    DistortionMesh mesh;
+    mesh.build(samples);
+    REQUIRE_FALSE(mesh.empty());
+
+    std::uniform_real_distribution<float> query(-0.05f, 1.05f);
+    for (std::size_t i = 0; i < 1000; ++i) {
+        checkAffine(mesh, query(generator), query(generator));
+    }
+}
+
+TEST_CASE("DistortionMesh interpolates channels sharing input points", "[DistortionMesh]")
+{
+    const auto red = makeGridSamples(17, 0.98);
+    const auto green = makeGridSamples(17, 1.0);
+    const auto blue = makeGridSamples(17, 1.02);
+
+    DistortionMesh shared;
+    shared.build(std::vector<const MonoPointDistortionMeshDescription*> { &red, &green, &blue });
+    REQUIRE(shared.getChannelCount() == 3);
+
+    DistortionMesh blue_only;
+    blue_only.build(blue);
+    REQUIRE(blue_only.getChannelCount() == 1);
+
+    for (float v = -0.05f; v <= 1.05f; v += 0.07f) {
+        for (float u = -0.05f; u <= 1.05f; u += 0.09f) {
+            float result[6];
+            shared.interpolate(u, v, result);
+            const auto expected = blue_only.interpolate(u, v);
+            CHECK(result[4] == expected[0]);
+            CHECK(result[5] == expected[1]);
+            CHECK(result[0] != result[4]);
+        }
+    }
+
+    SECTION("Channels with different input points can't share a mesh")
+    {
+        const auto other = makeGridSamples(9);
+        DistortionMesh mesh;
+        mesh.build(std::vector<const MonoPointDistortionMeshDescription*> { &red, &other });
+        CHECK(mesh.empty());
+    }
+}
+
+TEST_CASE("makeDistortionMeshes shares work between colors", "[DistortionMesh]")
+{
+    const auto red = makeGridSamples(9, 0.98);
+    const auto green = makeGridSamples(9, 1.0);
+    const auto blue = makeGridSamples(9, 1.02);
+
+    SECTION("Chromatic samples get one mesh with three channels")
+    {
+        const auto parameters = makeRgbParameters(red, green, blue);
+        const auto meshes = makeDistortionMeshes({ parameters, parameters }, 2);
+        REQUIRE(meshes.size() == 2);
+        REQUIRE(meshes[1].size() == 1);
+        CHECK(meshes[1][0].getChannelCount() == 3);
+
+        const auto coords = interpolateDistortion(0.3f, 0.6f, meshes[1]);
+        CHECK(coords.rfRed[0] != coords.rfBlue[0]);
+    }
+
+    SECTION("Achromatic samples get a single channel")
+    {
+        const auto parameters = makeRgbParameters(green, green, green);
+        const auto meshes = makeDistortionMeshes({ parameters, parameters }, 2);
+        REQUIRE(meshes[0].size() == 1);
+        CHECK(meshes[0][0].getChannelCount() == 1);
+
+        const auto coords = interpolateDistortion(0.3f, 0.6f, meshes[0]);
+        CHECK(coords.rfRed[0] == coords.rfGreen[0]);
+        CHECK(coords.rfBlue[1] == coords.rfGreen[1]);
+
+        const auto expected = meshes[0][0].interpolate(0.3f, 0.4f); // v flipped
+        CHECK(coords.rfGreen[0] == expected[0]);
+        CHECK(coords.rfGreen[1] == Approx(1.0f - expected[1]));
+    }
+
+    SECTION("The overfill factor scales about the center")
+    {
+        const auto parameters = makeRgbParameters(green, green, green);
+        const auto meshes = makeDistortionMeshes({ parameters, parameters }, 2);
+        const auto coords = interpolateDistortion(0.3f, 0.6f, meshes[0]);
+        const auto overfilled = interpolateDistortion(0.3f, 0.6f, meshes[0], 2.0f);
+        CHECK(overfilled.rfGreen[0] == Approx(0.5f + (coords.rfGreen[0] - 0.5f) / 2.0f));
+        CHECK(overfilled.rfGreen[1] == Approx(0.5f + (coords.rfGreen[1] - 0.5f) / 2.0f));
+    }
+}
+
+TEST_CASE("DistortionMesh caches the last triangle for raster-order queries", "[DistortionMesh]")
+{
+    // A curved distortion, so interpolating from the wrong triangle shows
+    std::mt19937 generator(4321);
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    MonoPointDistortionMeshDescription samples;
+    for (std::size_t i = 0; i < 1500; ++i) {
+        const auto u = distribution(generator);
+        const auto v = distribution(generator);
+        const auto r2 = (u - 0.5) * (u - 0.5) + (v - 0.5) * (v - 0.5);
+        samples.push_back({ { { { u, v } }, { { u * (1.0 + 0.3 * r2), v * (1.0 + 0.3 * r2) } } } });
+    }
+
+    DistortionMesh mesh;
+    mesh.build(samples);
+    REQUIRE_FALSE(mesh.empty());
+    CHECK(mesh.getCacheStatistics().hits == 0);
+    CHECK(mesh.getCacheStatistics().misses == 0);
+
+    // Scanline order, as SteamVR asks for the distortion
+    const std::size_t size = 128;
+    std::vector<std::array<float, 2>> raster;
+    for (std::size_t j = 0; j < size; ++j) {
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto u = static_cast<float>(i) / static_cast<float>(size - 1);
+            const auto v = static_cast<float>(j) / static_cast<float>(size - 1);
+            raster.push_back(mesh.interpolate(u, v));
+        }
+    }
+
+    const auto statistics = mesh.getCacheStatistics();
+    INFO(statistics.hits << " hits, " << statistics.misses << " misses");
+    CHECK(statistics.hits + statistics.misses == size * size);
+    CHECK(statistics.hits > 9 * statistics.misses);
+
+    // A copy has its own cache entries. Visiting the points in a random order
+    // defeats the cache, but the results must be the same.
+    const auto copy = mesh;
+    std::vector<std::size_t> order(size * size);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), generator);
+    for (const auto index : order) {
+        const auto u = static_cast<float>(index % size) / static_cast<float>(size - 1);
+        const auto v = static_cast<float>(index / size) / static_cast<float>(size - 1);
+        const auto result = copy.interpolate(u, v);
+        INFO("(" << u << ", " << v << ")");
+        CHECK(result[0] == Approx(raster[index][0]).epsilon(1e-5));
+        CHECK(result[1] == Approx(raster[index][1]).epsilon(1e-5));
+    }
+    CHECK(copy.getCacheStatistics().misses > mesh.getCacheStatistics().misses);
+
+    mesh.resetCacheStatistics();
+    CHECK(mesh.getCacheStatistics().hits == 0);
+}
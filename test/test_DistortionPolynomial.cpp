@@ -0,0 +1,167 @@
+/** @file
+    @brief Tests for DistortionPolynomial
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "Distortion.h"
+#include "DistortionPolynomial.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * A radial distortion about an off-center point with a little chromatic
+ * aberration.
+ */
+vr::DistortionCoordinates_t radial(float u, float v)
+{
+    const float k1[] = { 0.20f, 0.22f, 0.24f };
+    const auto du = u - 0.45f;
+    const auto dv = v - 0.52f;
+    const auto r2 = du * du + dv * dv;
+
+    float result[6];
+    for (std::size_t color = 0; color < 3; ++color) {
+        const auto scale = 1.0f + k1[color] * r2 + 0.1f * r2 * r2;
+        result[2 * color] = 0.45f + du * scale;
+        result[2 * color + 1] = 0.52f + dv * scale;
+    }
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = result[0];
+    coords.rfRed[1] = result[1];
+    coords.rfGreen[0] = result[2];
+    coords.rfGreen[1] = result[3];
+    coords.rfBlue[0] = result[4];
+    coords.rfBlue[1] = result[5];
+    return coords;
+}
+
+/**
+ * A smooth distortion that isn't radial: a shear and a keystone.
+ */
+vr::DistortionCoordinates_t keystone(float u, float v)
+{
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = coords.rfGreen[0] = coords.rfBlue[0] = 0.5f + (u - 0.5f) * (1.0f + 0.2f * v) + 0.05f * v;
+    coords.rfRed[1] = coords.rfGreen[1] = coords.rfBlue[1] = v + 0.03f * u * u * u;
+    return coords;
+}
+
+} // anonymous namespace
+
+TEST_CASE("DistortionPolynomial starts out empty", "[DistortionPolynomial]")
+{
+    DistortionPolynomial polynomial;
+    CHECK(polynomial.empty());
+    CHECK(polynomial.getModel() == DistortionPolynomial::Model::None);
+    CHECK_FALSE(polynomial.fitRadial({}));
+    CHECK_FALSE(polynomial.fitPolynomial(sampleDistortion(radial, 3), 3));
+    CHECK_FALSE(polynomial.fitPolynomial(sampleDistortion(radial, 9), DistortionPolynomial::MaxDegree + 1));
+    CHECK(polynomial.empty());
+}
+
+TEST_CASE("DistortionPolynomial fits radial distortion", "[DistortionPolynomial]")
+{
+    DistortionPolynomial polynomial;
+    REQUIRE(polynomial.fitRadial(sampleDistortion(radial, 17)));
+    CHECK(polynomial.getModel() == DistortionPolynomial::Model::Radial);
+    CHECK(polynomial.getMaxError(radial) < 1e-4);
+
+    const auto coords = polynomial.evaluate(0.1f, 0.9f);
+    const auto expected = radial(0.1f, 0.9f);
+    CHECK(coords.rfRed[0] == Approx(expected.rfRed[0]).epsilon(1e-4));
+    CHECK(coords.rfBlue[1] == Approx(expected.rfBlue[1]).epsilon(1e-4));
+
+    std::ostringstream description;
+    description << polynomial;
+    CHECK(description.str().find("radial") == 0);
+}
+
+TEST_CASE("fitDistortionPolynomial picks the simplest model that fits", "[DistortionPolynomial]")
+{
+    double error = 0.0;
+
+    SECTION("Radial distortion gets the radial model")
+    {
+        const auto polynomial = fitDistortionPolynomial(radial, 1e-4, 5, error);
+        CHECK(polynomial.getModel() == DistortionPolynomial::Model::Radial);
+        CHECK(error <= 1e-4);
+    }
+
+    SECTION("Other distortion gets a polynomial")
+    {
+        const auto polynomial = fitDistortionPolynomial(keystone, 1e-4, 5, error);
+        CHECK(polynomial.getModel() == DistortionPolynomial::Model::Polynomial);
+        CHECK(polynomial.getDegree() == 3);
+        CHECK(error <= 1e-4);
+        CHECK(polynomial.getMaxError(keystone) == Approx(error));
+    }
+
+    SECTION("Nothing is returned if no model fits")
+    {
+        const auto polynomial = fitDistortionPolynomial(keystone, 1e-4, 2, error);
+        CHECK(polynomial.empty());
+        CHECK(error > 1e-4);
+    }
+}
+
+TEST_CASE("DistortionPolynomial batches match single evaluations", "[DistortionPolynomial]")
+{
+    DistortionPolynomial polynomial;
+    REQUIRE(polynomial.fitPolynomial(sampleDistortion(radial, 17), 4));
+
+    std::vector<float> us;
+    std::vector<float> vs;
+    for (float v = 0.0f; v <= 1.0f; v += 0.11f) {
+        for (float u = 0.0f; u <= 1.0f; u += 0.07f) {
+            us.push_back(u);
+            vs.push_back(v);
+        }
+    }
+    const auto count = us.size();
+    std::vector<float> values(6 * count);
+    const DistortionBatch batch = { { &values[0 * count], &values[1 * count] }, { &values[2 * count], &values[3 * count] }, { &values[4 * count], &values[5 * count] } };
+    polynomial.evaluate(us.data(), vs.data(), count, batch);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto expected = polynomial.evaluate(us[i], vs[i]);
+        CHECK(batch.red[1][i] == expected.rfRed[1]);
+        CHECK(batch.green[0][i] == expected.rfGreen[0]);
+        CHECK(batch.blue[1][i] == expected.rfBlue[1]);
+    }
+}
@@ -0,0 +1,165 @@
+/** @file
+    @brief Tests for DistortionQuadtree
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "Distortion.h"
+#include "DistortionQuadtree.h"
+
+// Library/third-party includes
+#include <openvr_driver.h>
+
+// Standard includes
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+/**
+ * Nearly linear in the middle, strongly curved towards the edges, like a
+ * lens.
+ */
+vr::DistortionCoordinates_t lens(float u, float v)
+{
+    const auto du = u - 0.5f;
+    const auto dv = v - 0.5f;
+    const auto r2 = du * du + dv * dv;
+    const auto r4 = r2 * r2;
+
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = 0.5f + du * (1.0f + 0.9f * r4);
+    coords.rfRed[1] = 0.5f + dv * (1.0f + 0.9f * r4);
+    coords.rfGreen[0] = 0.5f + du * (1.0f + 1.0f * r4);
+    coords.rfGreen[1] = 0.5f + dv * (1.0f + 1.0f * r4);
+    coords.rfBlue[0] = 0.5f + du * (1.0f + 1.1f * r4);
+    coords.rfBlue[1] = 0.5f + dv * (1.0f + 1.1f * r4);
+    return coords;
+}
+
+vr::DistortionCoordinates_t affine(float u, float v)
+{
+    vr::DistortionCoordinates_t coords;
+    coords.rfRed[0] = coords.rfGreen[0] = coords.rfBlue[0] = 0.05f + 0.9f * u + 0.02f * v;
+    coords.rfRed[1] = coords.rfGreen[1] = coords.rfBlue[1] = -0.03f + 0.01f * u + 1.1f * v;
+    return coords;
+}
+
+} // anonymous namespace
+
+TEST_CASE("DistortionQuadtree starts out empty", "[DistortionQuadtree]")
+{
+    DistortionQuadtree quadtree;
+    CHECK(quadtree.empty());
+    CHECK(quadtree.getLeafCount() == 0);
+    CHECK(quadtree.getMemoryUsage() == 0);
+}
+
+TEST_CASE("DistortionQuadtree doesn't split linear distortion", "[DistortionQuadtree]")
+{
+    DistortionQuadtree quadtree;
+    quadtree.build(makeBatchFunction(affine), 1e-4f, 8);
+    REQUIRE_FALSE(quadtree.empty());
+    CHECK(quadtree.getLeafCount() == 1);
+    CHECK(quadtree.getVertexCount() == 4);
+    CHECK(quadtree.getDepth() == 0);
+    CHECK(quadtree.getMaxError(affine) < 1e-4);
+
+    const auto coords = quadtree.lookup(0.3f, 0.8f);
+    const auto expected = affine(0.3f, 0.8f);
+    CHECK(coords.rfGreen[0] == Approx(expected.rfGreen[0]).epsilon(1e-4));
+    CHECK(coords.rfBlue[1] == Approx(expected.rfBlue[1]).epsilon(1e-4));
+}
+
+TEST_CASE("DistortionQuadtree refines where the distortion curves", "[DistortionQuadtree]")
+{
+    const auto tolerance = 2e-4f;
+    DistortionQuadtree quadtree;
+    quadtree.build(makeBatchFunction(lens), tolerance, 8, 4);
+    REQUIRE_FALSE(quadtree.empty());
+    CHECK(quadtree.getDepth() <= 8);
+
+    SECTION("The error stays close to the tolerance")
+    {
+        // Only the cell centers and edge midpoints are tested while building.
+        CHECK(quadtree.getMaxError(lens) < 2.0 * tolerance);
+    }
+
+    SECTION("The middle is coarser than the edges")
+    {
+        // A dense table with the same error would need the deepest level's
+        // resolution everywhere.
+        const auto dense = (std::size_t { 1 } << quadtree.getDepth());
+        CHECK(quadtree.getLeafCount() < dense * dense / 4);
+
+        const auto dense_bytes = (dense + 1) * (dense + 1) * 6 * sizeof(float);
+        CHECK(quadtree.getMemoryUsage() < dense_bytes / 4);
+    }
+
+    SECTION("Building on one thread gives the same tree")
+    {
+        DistortionQuadtree serial;
+        serial.build(makeBatchFunction(lens), tolerance, 8, 1);
+        CHECK(serial.getLeafCount() == quadtree.getLeafCount());
+        const auto a = serial.lookup(0.91f, 0.07f);
+        const auto b = quadtree.lookup(0.91f, 0.07f);
+        CHECK(a.rfRed[0] == b.rfRed[0]);
+        CHECK(a.rfBlue[1] == b.rfBlue[1]);
+    }
+
+    SECTION("Batches match single lookups")
+    {
+        std::vector<float> us;
+        std::vector<float> vs;
+        for (float v = -0.1f; v <= 1.1f; v += 0.07f) {
+            for (float u = -0.1f; u <= 1.1f; u += 0.03f) {
+                us.push_back(u);
+                vs.push_back(v);
+            }
+        }
+        const auto count = us.size();
+        std::vector<float> values(6 * count);
+        const DistortionBatch batch = { { &values[0 * count], &values[1 * count] }, { &values[2 * count], &values[3 * count] }, { &values[4 * count], &values[5 * count] } };
+        quadtree.lookup(us.data(), vs.data(), count, batch);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto expected = quadtree.lookup(us[i], vs[i]);
+            CHECK(batch.red[0][i] == expected.rfRed[0]);
+            CHECK(batch.green[1][i] == expected.rfGreen[1]);
+            CHECK(batch.blue[0][i] == expected.rfBlue[0]);
+        }
+    }
+}
+
+TEST_CASE("DistortionQuadtree respects the maximum depth", "[DistortionQuadtree]")
+{
+    DistortionQuadtree quadtree;
+    quadtree.build(makeBatchFunction(lens), 0.0f, 3);
+    CHECK(quadtree.getDepth() == 3);
+    CHECK(quadtree.getLeafCount() == 64);
+    CHECK(quadtree.getVertexCount() == 81);
+}
@@ -0,0 +1,141 @@
+/** @file
+    @brief Tests for MotionEstimator
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "MotionEstimator.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <cstdint>
+
+namespace {
+
+const double Period = 0.004; // 250 Hz
+
+OSVR_TimeValue makeTime(int sample)
+{
+    const auto microseconds = static_cast<std::int64_t>(sample) * 4000;
+    OSVR_TimeValue tv;
+    tv.seconds = 1000 + microseconds / 1000000;
+    tv.microseconds = static_cast<OSVR_TimeValue_Microseconds>(microseconds % 1000000);
+    return tv;
+}
+
+const Eigen::Vector3d Velocity(2.0, -1.0, 0.5);
+const Eigen::Vector3d Acceleration(3.0, 0.0, -9.0);
+const Eigen::Vector3d AngularVelocity(0.3, -1.2, 2.0);
+
+Eigen::Vector3d positionAt(double t)
+{
+    return Eigen::Vector3d(1.0, 2.0, 3.0) + Velocity * t + 0.5 * Acceleration * t * t;
+}
+
+Eigen::Quaterniond orientationAt(double t)
+{
+    const Eigen::Quaterniond initial(Eigen::AngleAxisd(0.7, Eigen::Vector3d(1.0, 1.0, 0.0).normalized()));
+    return initial * Eigen::Quaterniond(Eigen::AngleAxisd(AngularVelocity.norm() * t, AngularVelocity.normalized()));
+}
+
+void addSample(MotionEstimator& estimator, int sample)
+{
+    const auto t = sample * Period;
+    estimator.addSample(makeTime(sample), positionAt(t), orientationAt(t));
+}
+
+} // anonymous namespace
+
+TEST_CASE("MotionEstimator needs two samples", "[MotionEstimator]")
+{
+    MotionEstimator estimator;
+    CHECK_FALSE(estimator.getEstimate().valid);
+
+    addSample(estimator, 0);
+    CHECK_FALSE(estimator.getEstimate().valid);
+
+    addSample(estimator, 1);
+    CHECK(estimator.getEstimate().valid);
+    CHECK_FALSE(estimator.getEstimate().hasAcceleration);
+
+    addSample(estimator, 2);
+    CHECK(estimator.getEstimate().hasAcceleration);
+}
+
+TEST_CASE("MotionEstimator recovers constant acceleration", "[MotionEstimator]")
+{
+    MotionEstimator estimator;
+    const int samples = 20;
+    for (int i = 0; i < samples; ++i) {
+        addSample(estimator, i);
+    }
+
+    const auto t = (samples - 1) * Period;
+    const auto& estimate = estimator.getEstimate();
+    REQUIRE(estimate.valid);
+    REQUIRE(estimate.hasAcceleration);
+    CHECK(estimate.velocity.isApprox(Velocity + Acceleration * t, 1e-6));
+    CHECK(estimate.acceleration.isApprox(Acceleration, 1e-6));
+    CHECK(estimate.angularVelocity.isApprox(AngularVelocity, 1e-6));
+    CHECK(estimate.angularAcceleration.norm() < 1e-6);
+}
+
+TEST_CASE("MotionEstimator ignores stale and out-of-order samples", "[MotionEstimator]")
+{
+    MotionEstimator estimator;
+    for (int i = 0; i < 5; ++i) {
+        addSample(estimator, i);
+    }
+    REQUIRE(estimator.getEstimate().valid);
+
+    SECTION("Out-of-order samples leave the estimate alone")
+    {
+        const auto before = estimator.getEstimate().velocity;
+        estimator.addSample(makeTime(2), Eigen::Vector3d::Zero(), Eigen::Quaterniond::Identity());
+        CHECK(estimator.getEstimate().velocity.isApprox(before));
+    }
+
+    SECTION("A long gap starts a new history")
+    {
+        addSample(estimator, 500);
+        CHECK_FALSE(estimator.getEstimate().valid);
+        addSample(estimator, 501);
+        CHECK(estimator.getEstimate().valid);
+    }
+
+    SECTION("Reset discards the history")
+    {
+        estimator.reset();
+        CHECK_FALSE(estimator.getEstimate().valid);
+        addSample(estimator, 5);
+        CHECK_FALSE(estimator.getEstimate().valid);
+    }
+}
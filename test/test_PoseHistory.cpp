@@ -0,0 +1,176 @@
+/** @file
+    @brief Tests for PoseHistory
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "PoseHistory.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+OSVR_TimeValue makeTime(double seconds)
+{
+    const auto microseconds = static_cast<std::int64_t>(std::floor(seconds * 1e6 + 0.5));
+    OSVR_TimeValue tv;
+    tv.seconds = 1000 + microseconds / 1000000;
+    tv.microseconds = static_cast<OSVR_TimeValue_Microseconds>(microseconds % 1000000);
+    return tv;
+}
+
+PoseSample makePose(double seconds, double x, double yaw)
+{
+    PoseSample pose;
+    pose.timestamp = makeTime(seconds);
+    pose.position = Eigen::Vector3d(x, 0.0, 0.0);
+    pose.orientation = Eigen::Quaterniond(Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitY()));
+    return pose;
+}
+
+double yawOf(const PoseSample& pose)
+{
+    const Eigen::AngleAxisd angle_axis(Eigen::Quaterniond(pose.orientation));
+    return angle_axis.angle() * angle_axis.axis().y();
+}
+
+} // anonymous namespace
+
+TEST_CASE("PoseHistory starts out empty", "[PoseHistory]")
+{
+    PoseHistory history;
+    PoseSample pose;
+    CHECK(history.size() == 0);
+    CHECK_FALSE(history.getPoseAt(makeTime(0.0), pose));
+}
+
+TEST_CASE("PoseHistory looks up poses by time", "[PoseHistory]")
+{
+    PoseHistory history;
+    const Eigen::Vector3d velocity(1.0, 0.0, 0.0);
+    const Eigen::Vector3d angular_velocity(0.0, 0.5, 0.0);
+    for (int i = 0; i <= 10; ++i) {
+        const auto t = i * 0.01;
+        history.insert(makePose(t, t, 0.5 * t), velocity, angular_velocity);
+    }
+    REQUIRE(history.size() == 11);
+
+    PoseSample pose;
+
+    SECTION("Exact sample times")
+    {
+        REQUIRE(history.getPoseAt(makeTime(0.03), pose));
+        CHECK(pose.position.x() == Approx(0.03));
+        CHECK(yawOf(pose) == Approx(0.015));
+    }
+
+    SECTION("Interpolation between samples")
+    {
+        REQUIRE(history.getPoseAt(makeTime(0.0425), pose));
+        CHECK(pose.position.x() == Approx(0.0425));
+        CHECK(yawOf(pose) == Approx(0.02125));
+    }
+
+    SECTION("Extrapolation past the newest sample")
+    {
+        REQUIRE(history.getPoseAt(makeTime(0.12), pose));
+        CHECK(pose.position.x() == Approx(0.12));
+        CHECK(yawOf(pose) == Approx(0.06));
+    }
+
+    SECTION("Times outside the history")
+    {
+        CHECK_FALSE(history.getPoseAt(makeTime(-0.001), pose));
+        CHECK_FALSE(history.getPoseAt(makeTime(1.0), pose));
+    }
+
+    SECTION("Out-of-order poses are ignored")
+    {
+        history.insert(makePose(0.05, 100.0, 0.0), velocity, angular_velocity);
+        CHECK(history.size() == 11);
+        REQUIRE(history.getPoseAt(makeTime(0.05), pose));
+        CHECK(pose.position.x() == Approx(0.05));
+    }
+}
+
+TEST_CASE("PoseHistory keeps only the newest poses", "[PoseHistory]")
+{
+    PoseHistory history;
+    const auto count = PoseHistory::Capacity + 10;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto t = i * 0.001;
+        history.insert(makePose(t, t, 0.0), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    }
+    CHECK(history.size() == PoseHistory::Capacity);
+
+    PoseSample pose;
+    CHECK_FALSE(history.getPoseAt(makeTime(0.005), pose));
+    REQUIRE(history.getPoseAt(makeTime(0.0105), pose));
+    CHECK(pose.position.x() == Approx(0.0105));
+}
+
+TEST_CASE("PoseHistory lookups run concurrently with inserts", "[PoseHistory]")
+{
+    // Every pose has x equal to its time, so any interpolated pose must too
+    // unless a lookup saw an entry being overwritten.
+    PoseHistory history;
+    std::atomic<bool> done { false };
+    std::atomic<int> bad_lookups { 0 };
+
+    std::thread reader([&] {
+        PoseSample pose;
+        while (!done.load()) {
+            for (int i = 0; i < 100; ++i) {
+                const auto t = i * 0.0025;
+                if (history.getPoseAt(makeTime(t), pose) && std::abs(pose.position.x() - t) > 1e-6) {
+                    ++bad_lookups;
+                }
+            }
+        }
+    });
+
+    for (std::size_t i = 0; i < 100 * PoseHistory::Capacity; ++i) {
+        const auto t = (i % (2 * PoseHistory::Capacity)) * 0.0005;
+        if (0 == i % (2 * PoseHistory::Capacity)) {
+            history.clear();
+        }
+        history.insert(makePose(t, t, 0.0), Eigen::Vector3d::UnitX(), Eigen::Vector3d::Zero());
+    }
+    done = true;
+    reader.join();
+
+    CHECK(bad_lookups.load() == 0);
+}
@@ -0,0 +1,126 @@
+/** @file
+    @brief Tests for PositionFilter
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "PositionFilter.h"
+
+// Library/third-party includes
+#include <Eigen/Core>
+
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const double Period = 1.0 / 60.0; // camera frame rate
+
+OSVR_TimeValue makeTime(double seconds)
+{
+    const auto microseconds = static_cast<std::int64_t>(std::floor(seconds * 1e6 + 0.5));
+    OSVR_TimeValue tv;
+    tv.seconds = 1000 + microseconds / 1000000;
+    tv.microseconds = static_cast<OSVR_TimeValue_Microseconds>(microseconds % 1000000);
+    return tv;
+}
+
+const Eigen::Vector3d Start(0.1, 1.6, -0.3);
+const Eigen::Vector3d Velocity(0.5, -0.2, 1.0);
+
+Eigen::Vector3d positionAt(double t)
+{
+    return Start + Velocity * t;
+}
+
+} // anonymous namespace
+
+TEST_CASE("PositionFilter starts out invalid", "[PositionFilter]")
+{
+    PositionFilter filter;
+    CHECK_FALSE(filter.valid());
+    CHECK(filter.getPosition(makeTime(0.0)).isZero());
+    CHECK(filter.getVelocity(makeTime(0.0)).isZero());
+}
+
+TEST_CASE("PositionFilter tracks constant velocity", "[PositionFilter]")
+{
+    PositionFilter filter;
+    for (int i = 0; i <= 60; ++i) {
+        const auto t = i * Period;
+        filter.update(makeTime(t), positionAt(t));
+    }
+    REQUIRE(filter.valid());
+
+    const auto last = 60 * Period;
+
+    SECTION("Velocity converges")
+    {
+        CHECK((filter.getVelocity(makeTime(last)) - Velocity).norm() < 1e-3);
+    }
+
+    SECTION("Position is extrapolated between measurements")
+    {
+        const auto t = last + 0.5 * Period;
+        CHECK((filter.getPosition(makeTime(t)) - positionAt(t)).norm() < 1e-4);
+    }
+
+    SECTION("Extrapolation stops at the limit")
+    {
+        filter.setMaxExtrapolation(0.05);
+        const auto limit = filter.getPosition(makeTime(last + 0.05));
+        CHECK((filter.getPosition(makeTime(last + 1.0)) - limit).norm() < 1e-9);
+        CHECK(filter.getVelocity(makeTime(last + 1.0)).isZero());
+    }
+}
+
+TEST_CASE("PositionFilter restarts after a gap", "[PositionFilter]")
+{
+    PositionFilter filter;
+    filter.setMaxExtrapolation(0.1);
+    filter.update(makeTime(0.0), positionAt(0.0));
+    filter.update(makeTime(Period), positionAt(Period));
+    CHECK_FALSE(filter.getVelocity(makeTime(Period)).isZero());
+
+    const Eigen::Vector3d jump(5.0, 5.0, 5.0);
+    filter.update(makeTime(1.0), jump);
+    CHECK((filter.getPosition(makeTime(1.0)) - jump).norm() < 1e-9);
+    CHECK(filter.getVelocity(makeTime(1.0)).isZero());
+}
+
+TEST_CASE("PositionFilter ignores out-of-order measurements", "[PositionFilter]")
+{
+    PositionFilter filter;
+    filter.update(makeTime(0.0), positionAt(0.0));
+    filter.update(makeTime(Period), positionAt(Period));
+    const auto before = filter.getPosition(makeTime(Period));
+
+    filter.update(makeTime(0.5 * Period), Eigen::Vector3d(9.0, 9.0, 9.0));
+    CHECK((filter.getPosition(makeTime(Period)) - before).norm() < 1e-9);
+}
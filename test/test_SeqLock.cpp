@@ -0,0 +1,144 @@
+/** @file
+    @brief Tests for SeqLock
+
+    @date 2017
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com>
+
+*/
+
+// Copyright 2017 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include "SeqLock.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Roughly the size of a vr::DriverPose_t. Every field of a consistent
+ * payload holds the same value.
+ */
+struct Payload {
+    std::uint64_t values[38];
+    bool valid;
+};
+
+Payload makePayload(std::uint64_t value)
+{
+    Payload payload;
+    for (auto& v : payload.values) {
+        v = value;
+    }
+    payload.valid = true;
+    return payload;
+}
+
+bool isConsistent(const Payload& payload)
+{
+    for (const auto v : payload.values) {
+        if (v != payload.values[0])
+            return false;
+    }
+    return payload.valid;
+}
+
+} // anonymous namespace
+
+TEST_CASE("SeqLock returns the stored value", "[SeqLock]")
+{
+    SeqLock<Payload> lock { makePayload(1) };
+    CHECK(lock.load().values[0] == 1);
+    CHECK(isConsistent(lock.load()));
+
+    lock.store(makePayload(2));
+    CHECK(lock.load().values[0] == 2);
+
+    for (std::uint64_t i = 3; i < 20; ++i) {
+        lock.store(makePayload(i));
+        REQUIRE(lock.load().values[37] == i);
+    }
+}
+
+TEST_CASE("SeqLock default-constructs its value", "[SeqLock]")
+{
+    SeqLock<Payload> lock;
+    const auto payload = lock.load();
+    CHECK(payload.values[0] == 0);
+    CHECK(payload.values[37] == 0);
+    CHECK_FALSE(payload.valid);
+}
+
+TEST_CASE("SeqLock never returns a torn value", "[SeqLock][stress]")
+{
+    SeqLock<Payload> lock { makePayload(0) };
+
+    const std::uint64_t writes = 2000000;
+    const auto reader_count = std::max(2u, std::thread::hardware_concurrency());
+
+    std::atomic<bool> done { false };
+    std::atomic<std::uint64_t> torn { 0 };
+    std::atomic<std::uint64_t> reversed { 0 };
+    std::atomic<std::uint64_t> reads { 0 };
+
+    std::vector<std::thread> readers;
+    for (unsigned i = 0; i < reader_count; ++i) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            std::uint64_t count = 0;
+            while (!done.load()) {
+                const auto payload = lock.load();
+                if (!isConsistent(payload))
+                    ++torn;
+                if (payload.values[0] < last)
+                    ++reversed;
+                last = payload.values[0];
+                ++count;
+            }
+            reads += count;
+        });
+    }
+
+    std::thread writer([&] {
+        for (std::uint64_t i = 1; i <= writes; ++i) {
+            lock.store(makePayload(i));
+        }
+        done = true;
+    });
+
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    INFO("Performed " << reads.load() << " reads with " << reader_count << " readers.");
+    CHECK(torn.load() == 0);
+    CHECK(reversed.load() == 0);
+    CHECK(lock.load().values[0] == writes);
+}